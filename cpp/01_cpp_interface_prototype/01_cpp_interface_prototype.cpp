@@ -42,6 +42,18 @@
 #include "./thread_safe_queue.h"
 #include "./scope_fail.h"
 #include "./generator.h"
+#include "tokenizer_service.h"
+#include "token_sink.h"
+#include "token_breakdown.h"
+#include "latency_histogram.h"
+#include "rt_profile.h"
+#include "trace.h"
+#include "step_counters.h"
+#include "load_generator.h"
+#include "model_paths.h"
+#ifdef MOCK_ENGINE
+#include "../mock/mock_ffi_module.h"
+#endif
 
 using namespace tvm;
 using namespace ffi;
@@ -126,10 +138,21 @@ public:
     _background_loop_thread.join();
     _background_stream_back_loop_thread.join();
   }
-  void init(std::string model, tvm::Device& device, std::string model_lib, std::string mode);
+  void init(std::string model, tvm::Device& device, std::string model_lib, std::string mode, int num_tokenizer_threads = 1, const RtProfile& rt_profile = RtProfile());
   ChatCompletionRequest create_chat_completion_request(std::string& model, std::string prompt, int max_tokens, bool stream);
   ChatCompletionResponse create(std::optional<std::string>& request_id, ChatCompletionRequest request); // class ChatCompletion -> create()
   std::string response_to_str(ChatCompletionResponse& response);
+  // Write generated token ids (and arrival times) into `sink`. Without
+  // `detokenize` the response text stays empty and text is produced on
+  // demand with make_detokenizer().
+  void set_token_sink(TokenSink* sink, bool detokenize = true);
+  LazyDetokenizer make_detokenizer(const TokenSink& sink);
+  // Split the wall time of every step of non-stream requests into interface
+  // stages (token_breakdown.h). nullptr turns it off.
+  void set_token_breakdown(TokenBreakdown* breakdown);
+  // Global function that creates the engine module, called by init().
+  // Call before init(), e.g. with kMockThreadedEngineFactory.
+  void set_engine_factory(std::string global_name);
 
 private:
   void _check_engine_config(std::string model, std::string model_lib, EngineMode mode, mlc::llm::serve::EngineConfig engine_config);
@@ -140,25 +163,36 @@ private:
   void _sync_request_stream_callback(tvm::ffi::Array<mlc::llm::serve::RequestStreamOutput> delta_outputs);
   std::variant<Generator<ChatCompletionStreamResponse>, ChatCompletionResponse> _chat_completion(Optional<String>& request_id, ChatCompletionRequest request);
   Generator<ChatCompletionStreamResponse> _handle_chat_completion(Optional<String>& request_id, ChatCompletionRequest request);
-  Generator<std::vector<CallbackStreamOutput>> _generate(std::vector<TokenIds> prompts, mlc::llm::serve::GenerationConfig generation_config, Optional<String>& request_id);
-  void _request_stream_callback_impl(std::vector<mlc::llm::serve::RequestStreamOutput> delta_outputs, std::vector<std::vector<CallbackStreamOutput>>& output_request_outputs, Optional<String>& output_request_final_usage_json_str);
+  Generator<std::vector<CallbackStreamOutput>> _generate(std::vector<TokenIds> prompts, mlc::llm::serve::GenerationConfig generation_config, Optional<String>& request_id, uint16_t trace_track);
+  void _request_stream_callback_impl(std::vector<mlc::llm::serve::RequestStreamOutput> delta_outputs, std::vector<std::vector<CallbackStreamOutput>>& output_request_outputs, Optional<String>& output_request_final_usage_json_str, uint16_t trace_track);
   
   // Functions in engine_base.py
-  std::optional<ChatCompletionStreamResponse> process_chat_completion_stream_output(std::vector<CallbackStreamOutput>& delta_outputs, mlc::llm::json_ffi::ChatCompletionRequest& request, Optional<String> request_id, bool use_function_calling, Array<Optional<String>> finish_reasons);
+  std::optional<ChatCompletionStreamResponse> process_chat_completion_stream_output(std::vector<CallbackStreamOutput>& delta_outputs, mlc::llm::json_ffi::ChatCompletionRequest& request, Optional<String> request_id, bool use_function_calling, Array<Optional<String>> finish_reasons, uint16_t trace_track);
   ChatCompletionResponse wrap_chat_completion_response(std::string& request_id, std::string& model, std::vector<std::string>& output_texts, std::vector<std::string>& finish_reasons);  
 private:
   Conversation _conv_template;
   std::vector<mlc::llm::json_ffi::ModelConfig> _model_config_list;
   mlc::llm::Tokenizer _tokenizer;
+  std::unique_ptr<TokenizerService> _tokenizer_service;
   tvm::runtime::Module _engine_module;
   std::thread _background_loop_thread;
   std::thread _background_stream_back_loop_thread;
   bool _terminated;
   mlc::llm::serve::EngineConfig _engine_config;
   int _max_input_sequence_length;
-  std::optional<mlc::llm::serve::EventTraceRecorder> _trace_recorder;
+  std::optional<mlc::llm::serve::EventTraceRecorder> _trace_recorder; // engine-side events
   BlockingQueue<tvm::ffi::Array<mlc::llm::serve::RequestStreamOutput>> _sync_output_queue;
   std::vector<mlc::llm::TextStreamer> _sync_text_streamers;
+  TokenSink* _token_sink = nullptr; // first choice only
+  bool _detokenize = true;
+  TokenBreakdown* _token_breakdown = nullptr;
+  std::string _engine_factory = "mlc.serve.create_threaded_engine";
+  // Resolved once in init(); GetGlobal / GetFunction are name lookups.
+  tvm::ffi::Function _token_data_func;
+  tvm::ffi::Function _create_request_func;
+  tvm::ffi::Function _add_request_func;
+  tvm::ffi::Function _abort_request_func;
+  tvm::ffi::Function _request_stream_output_unpack_func;
 };
 
 
@@ -200,6 +234,7 @@ std::variant<Generator<ChatCompletionStreamResponse>, ChatCompletionResponse> Cp
   }
 
   while(cmpl_generator.move_next()){
+    if(_token_breakdown != nullptr) _token_breakdown->Received();
     ChatCompletionStreamResponse response = cmpl_generator.current_value();
 
     //TODO: Doesn't care usage for now.
@@ -256,8 +291,15 @@ Generator<ChatCompletionStreamResponse> CppInterface::_handle_chat_completion(Op
     std::cout<< "[ERROR] Trace recorder is not initialized" << std::endl;
     exit(0);
   }
-  _trace_recorder.value()->AddEvent(request_id.value(), std::string("receive request"));
+  // interface-side events of this request (trace.h), keyed by request id.
+  // Interned once here and passed down; released when the request ends.
+  trace::TrackLease trace_lease(request_id.value());
+  uint16_t trace_track = trace_lease.id();
+  SEGMENT_TRACE_INSTANT("receive request", trace_track, 0);
   
+  // Per-request copy, like conv_template.model_copy(deep=True) in engine_base.py
+  Conversation conv_template = _conv_template;
+
   std::string role;
   ChatCompletionMessageContent content;
 
@@ -266,48 +308,40 @@ Generator<ChatCompletionStreamResponse> CppInterface::_handle_chat_completion(Op
     content = message.content;
     if(role == "system"){
       if(!content.IsNull()){
-        _conv_template.system_message = content.Text();
+        conv_template.system_message = content.Text();
         continue;
       }
-      _conv_template.system_message = "";
+      conv_template.system_message = "";
     }
-    _conv_template.messages.push_back(message);
+    conv_template.messages.push_back(message);
   }
 
   ChatCompletionMessage empty_assistant_message;
   empty_assistant_message.role = "assistant";
-  _conv_template.messages.push_back(empty_assistant_message);
+  conv_template.messages.push_back(empty_assistant_message);
 
   // - Get the prompt from template, and encode to token ids.
   // - Check prompt length
-  _trace_recorder.value()->AddEvent(request_id.value(), std::string("start tokenization"));
+  SEGMENT_TRACE_INSTANT("start tokenization", trace_track, 0);
   
   std::vector<TokenIds> prompts;
   // ***** engine_utils.process_prompts ***** START // TODO: Support more types
-  std::vector<std::string> input_prompts = mlc::llm::utils::ConvertConversationToPrompt(_conv_template); 
-
-  auto tokenizer_encode_func_ = tvm::ffi::Function::GetGlobal("mlc.tokenizers.TokenizerEncode");
-  if(!tokenizer_encode_func_.has_value()){
-    std::cout<<"[ERROR] Cannot create threaded engine"<<std::endl;
-    exit(0);
-  }
-  tvm::ffi::Function tokenizer_encode_func = tokenizer_encode_func_.value();
+  std::vector<std::string> input_prompts = mlc::llm::utils::ConvertConversationToPrompt(conv_template); 
 
   // TODO: Case 1 and 2 are skipped
   // Case 1. The prompt is single string.
   // Case 2. The pormpt is a list of token ids. 
 
-  // Case 3. A list of prompts
-  for(auto& input_prompt : input_prompts){
-    auto encoded_prompt = tokenizer_encode_func(_tokenizer, tvm::ffi::String(input_prompt)).cast<TokenIds>();
-    prompts.push_back(encoded_prompt);
+  // Case 3. A list of prompts (encoded in parallel, repeated prompts hit the cache)
+  for(auto& encoded_prompt : _tokenizer_service->EncodeBatch(input_prompts)){
+    prompts.push_back(TokenIds(encoded_prompt.begin(), encoded_prompt.end()));
   }
   // return output_prompts;
   // ***** engine_utils.process_prompts ***** END
 
-  _trace_recorder.value()->AddEvent(request_id.value(), std::string("finish tokenization"));
+  SEGMENT_TRACE_INSTANT("finish tokenization", trace_track, 0);
 
-  if(_conv_template.system_prefix_token_ids.has_value()){
+  if(conv_template.system_prefix_token_ids.has_value()){
     // TODO: SKIP
   }
 
@@ -324,8 +358,8 @@ Generator<ChatCompletionStreamResponse> CppInterface::_handle_chat_completion(Op
   
   // ***** engine_utils.get_generation_config ***** START
   ObjectPtr<mlc::llm::serve::GenerationConfigNode> generation_config_node = tvm::ffi::make_object<mlc::llm::serve::GenerationConfigNode>();
-  auto extra_stop_token_ids = _conv_template.stop_token_ids;
-  auto extra_stop_str = _conv_template.stop_str;
+  auto extra_stop_token_ids = conv_template.stop_token_ids;
+  auto extra_stop_str = conv_template.stop_str;
 
   // kwargs[arg_name] = getattr(request, arg_nbame)
   generation_config_node->n = request.n;
@@ -368,14 +402,15 @@ Generator<ChatCompletionStreamResponse> CppInterface::_handle_chat_completion(Op
   
   Array<Optional<String>> finish_reasons(generation_config->n, Optional<String>()); // TODO: push_back으로 해야하나?  
     
-  _trace_recorder.value()->AddEvent(request_id.value(), std::string("invoke generate"));
-  auto generate_output = _generate(prompts, generation_config, request_id);
+  SEGMENT_TRACE_INSTANT("invoke generate", trace_track, 0);
+  auto generate_output = _generate(prompts, generation_config, request_id, trace_track);
 
   while(generate_output.move_next()){
     std::vector<CallbackStreamOutput> delta_outputs = generate_output.current_value();
 
     bool use_function_calling = false; // TODO: use_function_calling is always "false" for now.
-    std::optional<ChatCompletionStreamResponse> response = process_chat_completion_stream_output(delta_outputs, request, request_id, false, finish_reasons);                                    
+    std::optional<ChatCompletionStreamResponse> response = process_chat_completion_stream_output(delta_outputs, request, request_id, false, finish_reasons, trace_track);                                    
+    if(_token_breakdown != nullptr) _token_breakdown->Mark(TokenStage::kResponse);
 
     if(response.has_value()){
       auto v = response.value();
@@ -386,10 +421,10 @@ Generator<ChatCompletionStreamResponse> CppInterface::_handle_chat_completion(Op
     }
   }
 
-  _trace_recorder.value()->AddEvent(request_id.value(), std::string("finish"));
+  SEGMENT_TRACE_INSTANT("finish", trace_track, 0);
 }
 
-std::optional<ChatCompletionStreamResponse> CppInterface::process_chat_completion_stream_output(std::vector<CallbackStreamOutput>& delta_outputs, mlc::llm::json_ffi::ChatCompletionRequest& request, Optional<String> request_id, bool use_function_calling, Array<Optional<String>> finish_reasons){
+std::optional<ChatCompletionStreamResponse> CppInterface::process_chat_completion_stream_output(std::vector<CallbackStreamOutput>& delta_outputs, mlc::llm::json_ffi::ChatCompletionRequest& request, Optional<String> request_id, bool use_function_calling, Array<Optional<String>> finish_reasons, uint16_t trace_track){
   std::optional<ChatCompletionStreamResponse> response;
 
   // # we always stream back the final chunk with usage
@@ -403,7 +438,7 @@ std::optional<ChatCompletionStreamResponse> CppInterface::process_chat_completio
       exit(0);
     }
 
-    _trace_recorder.value()->AddEvent(request_id.value(), std::string("yield final usage"));
+    SEGMENT_TRACE_INSTANT("yield final usage", trace_track, 0);
 
     ChatCompletionStreamResponse response_value;
     response_value.id = static_cast<std::string>(request_id.value());
@@ -438,7 +473,7 @@ std::optional<ChatCompletionStreamResponse> CppInterface::process_chat_completio
     }
     if(!finish_reason_updated && delta_output.delta_text.empty()){
       // # Ignore empty delta text when finish reason is not updated.
-      _trace_recorder.value()->AddEvent(request_id.value(), std::string("skip empty delta text"));
+      SEGMENT_TRACE_INSTANT("skip empty delta text", trace_track, 0);
     }
 
     ChatCompletionStreamResponseChoice choice;
@@ -472,7 +507,7 @@ std::optional<ChatCompletionStreamResponse> CppInterface::process_chat_completio
   response_value.choices = std::move(choices);
   response_value.model = request.model.value();
   response_value.system_fingerprint = "";
-  _trace_recorder.value()->AddEvent(request_id.value(), std::string("yield delta output"));
+  SEGMENT_TRACE_INSTANT("yield delta output", trace_track, 0);
 
   response = response_value;
   
@@ -480,18 +515,12 @@ std::optional<ChatCompletionStreamResponse> CppInterface::process_chat_completio
 }
 
 // Return Iterator
-Generator<std::vector<CallbackStreamOutput>> CppInterface::_generate(std::vector<TokenIds> prompts, mlc::llm::serve::GenerationConfig generation_config, Optional<String>& request_id){
+Generator<std::vector<CallbackStreamOutput>> CppInterface::_generate(std::vector<TokenIds> prompts, mlc::llm::serve::GenerationConfig generation_config, Optional<String>& request_id, uint16_t trace_track){
   // TODO: We only cares List[List[int]] prompts for now 
   // **** convert_prompts_to_data ***** START 
   
   Array<mlc::llm::serve::TokenData> input_data;
 
-  auto init_token_data_func_ = tvm::ffi::Function::GetGlobal("mlc.serve.TokenData");
-  if(!init_token_data_func_.has_value()){
-    std::cout<<"[ERROR] Cannot create token data"<<std::endl;
-    exit(0);
-  }
-  tvm::ffi::Function init_token_data_func = init_token_data_func_.value();
   for(IntTuple& prompt : prompts){
     std::vector<tvm::ffi::AnyView> prompt_vec;
     for(auto& v : prompt){
@@ -500,18 +529,19 @@ Generator<std::vector<CallbackStreamOutput>> CppInterface::_generate(std::vector
     
     // tvm::ffi::Any init_token_data_rv = init_token_data_func(tvm::ffi::PackedArgs(prompt_vec.data(), prompt_vec.size()));
     tvm::ffi::Any init_token_data_rv;
-    init_token_data_func.CallPacked(tvm::ffi::PackedArgs(prompt_vec.data(), prompt_vec.size()), &init_token_data_rv);
+    SEGMENT_FFI_CALL("mlc.serve.TokenData");
+    _token_data_func.CallPacked(tvm::ffi::PackedArgs(prompt_vec.data(), prompt_vec.size()), &init_token_data_rv);
     mlc::llm::serve::TokenData token_data = Downcast<mlc::llm::serve::TokenData>(init_token_data_rv);
     input_data.push_back(token_data);
   }
   
   // _ffi["create_request"]
-  tvm::ffi::Function create_request_func = _engine_module->GetFunction("create_request");
   picojson::object obj = generation_config->AsJSON();
   picojson::value val(obj);
   std::string generation_config_str = val.serialize();
   
-  tvm::ffi::Any create_request_rv = create_request_func(request_id, input_data, generation_config_str);
+  SEGMENT_FFI_CALL("create_request");
+  tvm::ffi::Any create_request_rv = _create_request_func(request_id, input_data, generation_config_str);
   
   
   mlc::llm::serve::Request request = Downcast<mlc::llm::serve::Request>(create_request_rv);
@@ -523,21 +553,24 @@ Generator<std::vector<CallbackStreamOutput>> CppInterface::_generate(std::vector
   }
 
   // _ffi["add_request"]
-  tvm::ffi::Function add_request_func = _engine_module->GetFunction("add_request");
-  add_request_func(request);
+  if(_token_breakdown != nullptr) _token_breakdown->Begin();
+  SEGMENT_FFI_CALL("add_request");
+  _add_request_func(request);
+  // Calls up to here (request setup) count as one step
+  StepCallCounter::Get().EndStep();
 
-  tvm::ffi::Function abort_request_func = _engine_module->GetFunction("abort_request");
-  
   // abort_func is executed when this function returns
-  ScopeFail guard([&abort_request_func] { abort_request_func(); });
+  ScopeFail guard([this] { _abort_request_func(); });
 
   while(true){
     tvm::ffi::Array<mlc::llm::serve::RequestStreamOutput> delta_outputs_ = _sync_output_queue.get();
+    if(_token_breakdown != nullptr) _token_breakdown->Dequeued();
     std::vector<mlc::llm::serve::RequestStreamOutput> delta_outputs(delta_outputs_.begin(), delta_outputs_.end());
     std::vector<std::vector<CallbackStreamOutput>> request_outputs;
     Optional<String> request_final_usage_json_str;
     
-    _request_stream_callback_impl(delta_outputs, request_outputs, request_final_usage_json_str);
+    _request_stream_callback_impl(delta_outputs, request_outputs, request_final_usage_json_str, trace_track);
+    StepCallCounter::Get().EndStep();
 
     for(std::vector<CallbackStreamOutput>& request_output : request_outputs){
       co_yield request_output;
@@ -557,19 +590,12 @@ Generator<std::vector<CallbackStreamOutput>> CppInterface::_generate(std::vector
   }
 }
 
-void CppInterface::_request_stream_callback_impl(std::vector<mlc::llm::serve::RequestStreamOutput> delta_outputs, std::vector<std::vector<CallbackStreamOutput>>& output_request_outputs, Optional<String>& output_request_final_usage_json_str){  
+void CppInterface::_request_stream_callback_impl(std::vector<mlc::llm::serve::RequestStreamOutput> delta_outputs, std::vector<std::vector<CallbackStreamOutput>>& output_request_outputs, Optional<String>& output_request_final_usage_json_str, uint16_t trace_track){  
   std::vector<std::vector<CallbackStreamOutput>>& batch_outputs = output_request_outputs;
 
   for(auto v : batch_outputs) v.clear();
   batch_outputs.clear();
 
-  auto request_stream_output_unpack_func_ = tvm::ffi::Function::GetGlobal("mlc.serve.RequestStreamOutputUnpack");
-  if(!request_stream_output_unpack_func_.has_value()){
-    std::cout<<"[ERROR] Cannot unpack request stream output"<<std::endl;
-    exit(0);
-  }
-  tvm::ffi::Function request_stream_output_unpack_func = request_stream_output_unpack_func_.value();
-
   for(mlc::llm::serve::RequestStreamOutput delta_output : delta_outputs){
     String request_id;
     std::vector<SingleRequestStreamOutput> stream_outputs; // field[0]
@@ -580,7 +606,8 @@ void CppInterface::_request_stream_callback_impl(std::vector<mlc::llm::serve::Re
     Array<Optional<String>> group_finish_reason; // field[3]
     Optional<String> request_final_usage_json_str; // field[4]
     Array<String> group_extra_prefix_string; // field[5]
-    tvm::ffi::Any fields_ = request_stream_output_unpack_func(delta_output);
+    SEGMENT_FFI_CALL("mlc.serve.RequestStreamOutputUnpack");
+    tvm::ffi::Any fields_ = _request_stream_output_unpack_func(delta_output);
     Array<tvm::ffi::ObjectRef> fields = Downcast<Array<tvm::ffi::ObjectRef>>(fields_);
     
     request_id = Downcast<String>(fields[0]);    
@@ -589,6 +616,10 @@ void CppInterface::_request_stream_callback_impl(std::vector<mlc::llm::serve::Re
     group_finish_reason = Downcast<Array<Optional<String>>>(fields[3]);
     request_final_usage_json_str = Downcast<Optional<String>>(fields[4]);
     group_extra_prefix_string = Downcast<Array<String>>(fields[5]);
+    if(_token_breakdown != nullptr){
+      if(group_delta_token_ids.size() > 0) _token_breakdown->AddTokens(group_delta_token_ids[0].size());
+      _token_breakdown->Mark(TokenStage::kUnpack);
+    }
     
     if(request_final_usage_json_str.has_value()){
       SingleRequestStreamOutput stream_output_value;
@@ -623,7 +654,7 @@ void CppInterface::_request_stream_callback_impl(std::vector<mlc::llm::serve::Re
     // ***** unpck() ***** END //
 
     /////////////////////////////////////////////////////////////////////
-    _trace_recorder.value()->AddEvent(request_id, std::string("start callback"));
+    SEGMENT_TRACE_INSTANT("start callback", trace_track, 0);
 
     // final chunk is now always indicated by a chunk
     // where usage json is present
@@ -641,19 +672,26 @@ void CppInterface::_request_stream_callback_impl(std::vector<mlc::llm::serve::Re
       SingleRequestStreamOutput stream_output = stream_outputs[i];      
       mlc::llm::TextStreamer text_streamer = _sync_text_streamers[i];
       
-      _trace_recorder.value()->AddEvent(request_id, std::string("start detokenization"));
-      
-      String delta_text("");
-      delta_text = delta_text + stream_output.extra_prefix_string;
-      if(stream_output.delta_token_ids.size() > 0){
-        delta_text = delta_text + text_streamer->Put({group_delta_token_ids[i]->data, group_delta_token_ids[i]->data + group_delta_token_ids[i]->size});
+      if(_token_sink != nullptr && i == 0){
+        _token_sink->Append(group_delta_token_ids[i]->data, group_delta_token_ids[i]->size);
       }
+
+      SEGMENT_TRACE_INSTANT("start detokenization", trace_track, 0);
       
-      if(stream_output.finish_reason.has_value()){
-        delta_text = delta_text + text_streamer->Finish();
+      String delta_text("");
+      if(_detokenize){
+        delta_text = delta_text + stream_output.extra_prefix_string;
+        if(stream_output.delta_token_ids.size() > 0){
+          delta_text = delta_text + text_streamer->Put({group_delta_token_ids[i]->data, group_delta_token_ids[i]->data + group_delta_token_ids[i]->size});
+        }
+        
+        if(stream_output.finish_reason.has_value()){
+          delta_text = delta_text + text_streamer->Finish();
+        }
       }
       
-      _trace_recorder.value()->AddEvent(request_id, std::string("finish detokenization"));
+      SEGMENT_TRACE_INSTANT("finish detokenization", trace_track, 0);
+      if(_token_breakdown != nullptr) _token_breakdown->Mark(TokenStage::kDetokenize);
 
       CallbackStreamOutput callback_stream_output_value;
       callback_stream_output_value.delta_text = delta_text;
@@ -663,7 +701,7 @@ void CppInterface::_request_stream_callback_impl(std::vector<mlc::llm::serve::Re
       outputs.push_back(callback_stream_output_value);
     }
     batch_outputs.push_back(outputs);
-    _trace_recorder.value()->AddEvent(request_id, std::string("finish callback"));
+    SEGMENT_TRACE_INSTANT("finish callback", trace_track, 0);
   }
 
   output_request_final_usage_json_str = std::nullopt;
@@ -755,7 +793,10 @@ void CppInterface::_process_model_args(std::vector<ModelInfo>& models, tvm::Devi
 
 
 // TODO: Add engine config to args
-void CppInterface::init(std::string model, tvm::Device& device, std::string model_lib, std::string mode){
+void CppInterface::init(std::string model, tvm::Device& device, std::string model_lib, std::string mode, int num_tokenizer_threads, const RtProfile& rt_profile){
+  // - Real-time profile (opt-in): lock and prefault memory before the engine allocates
+  rt::ApplyProcess(rt_profile);
+
   // - Check the fields fields of `engine_config`.
   mlc::llm::serve::EngineConfig engine_config(make_object<mlc::llm::serve::EngineConfigNode>());
   // _check_engine_config(model, model_lib, engine_config); // Not necessary
@@ -783,15 +824,37 @@ void CppInterface::init(std::string model, tvm::Device& device, std::string mode
   // Skip creating engine state  
   
   // tvm.get_global_func["mlc.serve.create_threaded_engine"]
-  auto create_threaded_engine_func_ = tvm::ffi::Function::GetGlobal("mlc.serve.create_threaded_engine");
+  auto create_threaded_engine_func_ = tvm::ffi::Function::GetGlobal(_engine_factory);
   if(!create_threaded_engine_func_.has_value()){
     std::cout<<"[ERROR] Cannot create threaded engine"<<std::endl;
     exit(0);
   }
   tvm::ffi::Function create_threaded_engine_func = create_threaded_engine_func_.value();
   _engine_module = create_threaded_engine_func().cast<tvm::runtime::Module>();
+
+  // Functions called for every request / step
+  auto init_token_data_func_ = tvm::ffi::Function::GetGlobal("mlc.serve.TokenData");
+  if(!init_token_data_func_.has_value()){
+    std::cout<<"[ERROR] Cannot create token data"<<std::endl;
+    exit(0);
+  }
+  _token_data_func = init_token_data_func_.value();
+  auto request_stream_output_unpack_func_ = tvm::ffi::Function::GetGlobal("mlc.serve.RequestStreamOutputUnpack");
+  if(!request_stream_output_unpack_func_.has_value()){
+    std::cout<<"[ERROR] Cannot unpack request stream output"<<std::endl;
+    exit(0);
+  }
+  _request_stream_output_unpack_func = request_stream_output_unpack_func_.value();
+  _create_request_func = _engine_module->GetFunction("create_request");
+  _add_request_func = _engine_module->GetFunction("add_request");
+  _abort_request_func = _engine_module->GetFunction("abort_request");
   
   _tokenizer = mlc::llm::Tokenizer::FromPath(model_args[0]["model"]);
+  // Each tokenization worker owns its tokenizer instance (the HF handle is not thread-safe)
+  _tokenizer_service = std::make_unique<TokenizerService>([path = model_args[0]["model"]](int){
+    mlc::llm::Tokenizer tokenizer = mlc::llm::Tokenizer::FromPath(path);
+    return [tokenizer](const std::string& text){ return tokenizer->Encode(text); };
+  }, num_tokenizer_threads);
 
   // _ffi["init_threaded_engine"]
   tvm::ffi::Function init_threaded_engine_func = _engine_module->GetFunction("init_threaded_engine");
@@ -816,13 +879,21 @@ void CppInterface::init(std::string model, tvm::Device& device, std::string mode
   // - Create the background engine-driving thread and start the loop
   // _ffi["run_background_loop"]
   tvm::ffi::Function run_background_loop_func = _engine_module->GetFunction("run_background_loop");
-  _background_loop_thread = std::thread([func = std::move(run_background_loop_func)](){
+  _background_loop_thread = std::thread([func = std::move(run_background_loop_func), rt_profile](){
+      if(rt_profile.enabled){
+        rt::ApplyToThread(rt_profile.engine_loop, "engine loop");
+        rt::PrefaultStack(rt_profile.prefault_stack_bytes);
+      }
       func();
   });
 
   // _ffi["run_background_stream_back_loop"]
   tvm::ffi::Function run_background_stream_back_loop_func = _engine_module->GetFunction("run_background_stream_back_loop");
-  _background_stream_back_loop_thread = std::thread([func = std::move(run_background_stream_back_loop_func)](){
+  _background_stream_back_loop_thread = std::thread([func = std::move(run_background_stream_back_loop_func), rt_profile](){
+      if(rt_profile.enabled){
+        rt::ApplyToThread(rt_profile.stream_back, "stream back");
+        rt::PrefaultStack(rt_profile.prefault_stack_bytes);
+      }
       func();
   });
 
@@ -854,7 +925,29 @@ void CppInterface::init(std::string model, tvm::Device& device, std::string mode
 
 
 void CppInterface::_sync_request_stream_callback(tvm::ffi::Array<mlc::llm::serve::RequestStreamOutput> delta_outputs){
+  if(_token_breakdown != nullptr) _token_breakdown->CallbackEnter();
   _sync_output_queue.put_nowait(delta_outputs);
+  if(_token_breakdown != nullptr) _token_breakdown->CallbackExit();
+}
+
+void CppInterface::set_token_sink(TokenSink* sink, bool detokenize){
+  _token_sink = sink;
+  _detokenize = detokenize || sink == nullptr;
+}
+
+void CppInterface::set_engine_factory(std::string global_name){
+  _engine_factory = std::move(global_name);
+}
+
+void CppInterface::set_token_breakdown(TokenBreakdown* breakdown){
+  _token_breakdown = breakdown;
+}
+
+LazyDetokenizer CppInterface::make_detokenizer(const TokenSink& sink){
+  mlc::llm::TextStreamer text_streamer(_tokenizer);
+  return LazyDetokenizer(sink, [text_streamer](const std::vector<int32_t>& token_ids) mutable {
+    return std::string(text_streamer->Put(token_ids));
+  });
 }
 
 ChatCompletionRequest CppInterface::create_chat_completion_request(std::string& model, std::string prompt, int max_tokens, bool stream){
@@ -880,16 +973,158 @@ std::string CppInterface::response_to_str(ChatCompletionResponse& response){
 }
 
 int main(int argc, char* argv[]){
-  std::string model_dir = "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace";
-  std::string model_lib_path = model_dir + "/llama-3.2-1b-cuda.so";
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
   tvm::Device dev{kDLCUDA, 0};
   std::string mode = "local";
 
+  // Opt-in: ./01_cpp_interface_prototype rt, or profile rt (needs CAP_SYS_NICE and CAP_IPC_LOCK)
+  bool profile_mode = argc > 1 && std::string(argv[1]) == "profile";
+  RtProfile rt_profile;
+  if(argc > 1 && (std::string(argv[1]) == "rt" || (profile_mode && argc > 2 && std::string(argv[2]) == "rt"))){
+    rt_profile.enabled = true;
+    rt_profile.engine_loop = {2, 80};
+    rt_profile.stream_back = {3, 70};
+    rt_profile.caller = {4, 60};
+  }
+
   CppInterface cpp_interface;
-  cpp_interface.init(model_dir, dev, model_lib_path, mode);
+  // MOCK_ENGINE=1: serve from the CPU mock engine (MOCK_* latency model),
+  // the model directory is still read for its config and tokenizer.
+  // Only in a build with -DMOCK_ENGINE (see build.sh)
+  if(std::getenv("MOCK_ENGINE") != nullptr && std::atoi(std::getenv("MOCK_ENGINE")) != 0){
+#ifdef MOCK_ENGINE
+    RegisterMockThreadedEngine();
+    cpp_interface.set_engine_factory(kMockThreadedEngineFactory);
+#else
+    std::cout << "[ERROR] MOCK_ENGINE is set but this binary was built without -DMOCK_ENGINE" << std::endl;
+    exit(0);
+#endif
+  }
+  cpp_interface.init(model_dir, dev, model_lib_path, mode, 1, rt_profile);
 
   std::optional<std::string> request_id = std::nullopt; // no request_id
 
+  // Per-step interface overhead: ./01_cpp_interface_prototype breakdown
+  // (compare with evaluation/08_overhead_breakdown/python_breakdown.py)
+  if(argc > 1 && std::string(argv[1]) == "breakdown"){
+    int n = 10;
+    int warmup = 2;
+    std::string breakdown_prompt("Why USA is the one of the strongest country?");
+    ChatCompletionRequest breakdown_request = cpp_interface.create_chat_completion_request(model_dir, breakdown_prompt, 256, false);
+    breakdown_request.seed = 4542; // For same experiment
+
+    TokenBreakdown breakdown;
+    cpp_interface.set_token_breakdown(&breakdown);
+    for(int i = 0; i < n + warmup; i++){
+      if(i == warmup){
+        breakdown.Clear();
+        StepCallCounter::Get().Clear();
+      }
+      cpp_interface.create(request_id, breakdown_request);
+    }
+    cpp_interface.set_token_breakdown(nullptr);
+    breakdown.Print(std::cout, "C++ interface per-step breakdown");
+    StepCallCounter::Get().Print(std::cout, "CppInterface-side FFI calls per step, engine step loop not counted");
+    return 0;
+  }
+
+  // Token latency with and without the real-time profile:
+  // ./01_cpp_interface_prototype profile [default|rt] [n]
+  // Unlike evaluation/05_rt_profile (SegmentRunner, caller thread only) this runs
+  // the engine loop and stream-back threads the profile pins and prioritizes
+  if(profile_mode){
+    int n = argc > 3 ? atoi(argv[3]) : 10;
+    int warmup = 1;
+    int profile_max_tokens = 512;
+    std::ifstream prompt_file("../../evaluation/02_cpp_segment_runner/input.txt");
+    if(!prompt_file.is_open()){
+      std::cout << "[ERROR] Cannot open ../../evaluation/02_cpp_segment_runner/input.txt" << std::endl;
+      exit(0);
+    }
+    std::stringstream prompt_buffer;
+    prompt_buffer << prompt_file.rdbuf();
+    ChatCompletionRequest profile_request = cpp_interface.create_chat_completion_request(model_dir, prompt_buffer.str(), profile_max_tokens, false);
+    profile_request.seed = 4542; // For same experiment
+
+    std::vector<int32_t> token_ids(profile_max_tokens);
+    std::vector<int64_t> token_times(profile_max_tokens);
+    LatencyRecorder latency(warmup);
+    for(int i = 0; i < n + warmup; i++){
+      latency.StartIteration(i);
+      TokenSink sink(token_ids.data(), token_ids.size(), token_times.data());
+      cpp_interface.set_token_sink(&sink, true);
+      auto start = std::chrono::steady_clock::now();
+      cpp_interface.create(request_id, profile_request);
+      auto end = std::chrono::steady_clock::now();
+      cpp_interface.set_token_sink(nullptr);
+      if(sink.total() == 0) continue;
+      // Sink timestamps are steady_clock nanoseconds, taken when the caller unpacks the output
+      auto first = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(sink.timestamp_ns(0)));
+      latency.Record("time to first token", first - start);
+      for(size_t t = 1; t < sink.total(); t++){
+        latency.Record("inter-token gap", std::chrono::nanoseconds(sink.timestamp_ns(t) - sink.timestamp_ns(t - 1)));
+      }
+      latency.Record("total", end - start);
+    }
+    std::cout << "===========================" << std::endl;
+    std::cout << "profile: " << (rt_profile.enabled ? "rt" : "default") << " (cpp interface)" << std::endl;
+    latency.Print(std::cout);
+    return 0;
+  }
+
+  // Sequential baseline of open-loop load through CppInterface:
+  // ./01_cpp_interface_prototype load [qps,...] [num_requests] [max_tokens]
+  // CppInterface keeps one request in flight (one output queue and text streamer),
+  // so the batching engine never sees concurrent requests: this measures queueing
+  // in front of a serial server, not TTFT/TPOT under concurrency, and reports no
+  // saturation knee. That needs per-request output queues in CppInterface
+  // (evaluation/07_load_generator runs N unbatched SegmentRunners instead)
+  if(argc > 1 && std::string(argv[1]) == "load"){
+    std::vector<double> qps_list{0.5, 1, 2, 4};
+    if(argc > 2){
+      qps_list.clear();
+      std::stringstream ss(argv[2]);
+      std::string item;
+      while(std::getline(ss, item, ',')) if(!item.empty()) qps_list.push_back(atof(item.c_str()));
+    }
+    int num_requests = argc > 3 ? atoi(argv[3]) : 100;
+    int load_max_tokens = argc > 4 ? atoi(argv[4]) : 256;
+
+    LoadRequest load_request;
+    load_request.prompt = "Why USA is the one of the strongest country?";
+    load_request.max_tokens = load_max_tokens;
+    std::vector<LoadRequest> requests(num_requests, load_request);
+
+    // One worker, so requests queue in the generator, not in the engine.
+    // Token times come from the sink. It is appended in
+    // _request_stream_callback_impl on this (the caller's) thread after
+    // _sync_output_queue.get(), so TTFT includes the hand-off from the
+    // stream-back thread.
+    LoadGenerator generator([&](int worker, const LoadRequest& request, const LoadGenerator::TokenCallback& on_tokens){
+      std::vector<int32_t> token_ids(request.max_tokens);
+      std::vector<int64_t> token_times(request.max_tokens);
+      TokenSink sink(token_ids.data(), token_ids.size(), token_times.data());
+      ChatCompletionRequest chat_request = cpp_interface.create_chat_completion_request(model_dir, request.prompt, request.max_tokens, false);
+      cpp_interface.set_token_sink(&sink, true);
+      cpp_interface.create(request_id, chat_request);
+      cpp_interface.set_token_sink(nullptr);
+      for(size_t i = 0; i < sink.total(); i++){
+        auto produced = std::chrono::duration_cast<LoadGenerator::Clock::duration>(std::chrono::nanoseconds(sink.timestamp_ns(i)));
+        on_tokens(1, LoadGenerator::Clock::time_point(produced));
+      }
+    }, 1, "cpp-interface sequential baseline (one request in flight)");
+
+    LoadSlo slo;
+    for(double qps : qps_list){
+      LoadReport report = generator.Run(requests, PoissonArrivals(requests.size(), qps, 4542), slo);
+      report.offered_qps = qps;
+      PrintLoadReport(std::cout, report);
+    }
+    return 0;
+  }
+
   // std::string prompt("Answer the following question in one sentence. What is the capital of South Korea?");
 
   std::string prompt("Can you introduce yourself?");
@@ -901,5 +1136,24 @@ int main(int argc, char* argv[]){
 
   std::cout<<"MLC-LLM Output: "<<cpp_interface.response_to_str(response)<<std::endl;
 
+  // - Token ids into a preallocated buffer, detokenized only when needed
+  std::vector<int32_t> token_ids(max_tokens);
+  std::vector<int64_t> token_times(max_tokens);
+  TokenSink sink(token_ids.data(), token_ids.size(), token_times.data());
+  cpp_interface.set_token_sink(&sink, false);
+  cpp_interface.create(request_id, request);
+  cpp_interface.set_token_sink(nullptr);
+
+  std::cout<<"[debug] tokens: "<<sink.total()<<std::endl;
+  if(sink.total() > 1){
+    auto span = std::chrono::nanoseconds(sink.timestamp_ns(sink.total() - 1) - sink.timestamp_ns(0));
+    std::cout<<"[debug] token span: "<<std::chrono::duration<float, std::milli>(span).count()<<"ms"<<std::endl;
+  }
+  LazyDetokenizer detokenizer = cpp_interface.make_detokenizer(sink);
+  std::cout<<"MLC-LLM Output (lazy): "<<detokenizer.Text()<<std::endl;
+
+  trace::ExportChromeJSON("trace.json");
+  trace::ExportPerfetto("trace.perfetto-trace");
+
   return 0;
 }
\ No newline at end of file
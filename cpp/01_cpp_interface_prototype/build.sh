@@ -1,3 +1,5 @@
+# Add -DMOCK_ENGINE to compile in the CPU mock engine (../mock/mock_ffi_module.h),
+# then run with MOCK_ENGINE=1. The default build does not include it.
 g++ -std=c++20 \
     -o 01_cpp_interface_prototype 01_cpp_interface_prototype.cpp \
     -I/home/rubis/workspace/tvm-segment-21/include \
@@ -8,6 +10,7 @@ g++ -std=c++20 \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/tokenizers-cpp/include \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/xgrammar/3rdparty/picojson \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/xgrammar/include \
+    -I../common \
     -L/home/rubis/workspace/tvm-segment-21/build \
     -L/home/rubis/workspace/mlc-llm-segment/build \
     -lpthread -lcurl -ljpeg -ldeflate \
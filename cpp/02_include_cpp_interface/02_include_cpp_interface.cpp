@@ -45,6 +45,7 @@
 #include <serve/segment_runner/scope_fail.h>
 #include <serve/segment_runner/generator.h>
 #include <serve/segment_runner/cpp_interface.h>
+#include "model_paths.h"
 
 using namespace tvm;
 using namespace ffi;
@@ -53,8 +54,9 @@ using ChatCompletionRequest = mlc::llm::json_ffi::ChatCompletionRequest;
 using ChatCompletionResponse = mlc::llm::json_ffi::ChatCompletionResponse;
 
 int main(int argc, char* argv[]){
-  std::string model_dir = "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace";
-  std::string model_lib_path = model_dir + "/llama-3.2-1b-cuda.so";
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
   tvm::Device dev{kDLCUDA, 0};
   std::string mode = "local";
 
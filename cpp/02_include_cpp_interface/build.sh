@@ -8,6 +8,7 @@ g++ -std=c++20 \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/tokenizers-cpp/include \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/xgrammar/3rdparty/picojson \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/xgrammar/include \
+    -I../common \
     -L/home/rubis/workspace/tvm-segment-21/build \
     -L/home/rubis/workspace/mlc-llm-segment/build \
     -lpthread -lcurl -ljpeg -ldeflate \
@@ -8,6 +8,10 @@
 
 #include <serve/segment_runner/segment_runner.h>
 
+#include "segment_timeline.h"
+#include "step_counters.h"
+#include "model_paths.h"
+
 using namespace tvm;
 using namespace ffi;
 
@@ -26,8 +30,9 @@ std::string readFileToString(const std::string& filePath) {
 }
 
 int main(int argc, char* argv[]){
-  std::string model_dir = "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b";
-  std::string model_lib_path = model_dir + "/llama-3.2-1b-cuda.so";
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
   tvm::Device dev{kDLCUDA, 0};
   std::string mode = "local";
 
@@ -36,6 +41,10 @@ int main(int argc, char* argv[]){
   segment_runner.Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
   segment_runner.SetSeed(4542); // For same experiment
   std::cout<<"[debug] After Init"<<std::endl;
+#if SEGMENT_TIMELINE_CUDA
+  // Device time per action / function from CUDA events (see build.sh)
+  timeline::Recorder::Get().SetDeviceTimer(std::make_unique<timeline::CudaEventTimer>());
+#endif
 
   std::optional<std::string> request_id = std::nullopt; // no request_id
 
@@ -48,10 +57,14 @@ int main(int argc, char* argv[]){
 
   std::cout<< "# FIRST REQUEST" << std::endl;
   int max_tokens = 4096;
-  segment_runner.Request(prompt, max_tokens);
+  {
+    SEGMENT_TIMELINE_SEGMENT("request");
+    segment_runner.Request(prompt, max_tokens);
+  }
   std::cout<<"[debug] After request"<<std::endl;
   
   while(!segment_runner.IsPrefillEnd()){
+    SEGMENT_TIMELINE_SEGMENT("prefill");
     segment_runner.Prefill(1);
     std::cout<<"PEFILL"<<std::endl;
   }
@@ -61,12 +74,24 @@ int main(int argc, char* argv[]){
 
   while(!segment_runner.IsEnd()){
     std::cout<<"PRE_SEGMENT"<<std::endl;
-    std::string delta = segment_runner.Execute(1);
+    std::string delta;
+    {
+      SEGMENT_TIMELINE_SEGMENT("execute");
+      delta = segment_runner.Execute(1);
+    }
     std::cout<<"POST_SEGMENT"<<std::endl;
     output += delta;
   }
 
   std::cout<<"MLC-LLM Output: "<<output<<std::endl;
 
+  // Engine actions and packed functions per segment (the engine reports
+  // them through SEGMENT_TIMELINE_ACTION / SEGMENT_TIMELINE_FUNC)
+  timeline::Recorder::Get().Print(std::cout);
+  // Only the mock engine counts its calls; the fork's step loop is not instrumented
+  if(StepCallCounter::Get().steps() > 0)
+    StepCallCounter::Get().Print(std::cout, "Mock engine FFI calls per step, scripted by the mock, not measured");
+  trace::ExportPerfetto("trace.perfetto-trace");
+
   return 0;
 }
\ No newline at end of file
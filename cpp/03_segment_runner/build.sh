@@ -8,10 +8,13 @@ g++ -std=c++20 \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/tokenizers-cpp/include \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/xgrammar/3rdparty/picojson \
     -I/home/rubis/workspace/mlc-llm-segment/3rdparty/xgrammar/include \
+    -I../common \
     -L/home/rubis/workspace/tvm-segment-21/build \
     -L/home/rubis/workspace/mlc-llm-segment/build \
     -lpthread -lcurl -ljpeg -ldeflate \
     -lopencv_core -lopencv_imgproc -lopencv_highgui -lopencv_imgcodecs \
     -ltvm_runtime \
     -lmlc_llm \
-    -lmlc_llm_module
\ No newline at end of file
+    -lmlc_llm_module
+
+# Device time in the timeline table: add -DSEGMENT_TIMELINE_CUDA=1 -lcudart
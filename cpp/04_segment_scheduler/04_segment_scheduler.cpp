@@ -0,0 +1,153 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include <serve/segment_runner/segment_runner.h>
+
+#include "cost_model.h"
+#include "segment_scheduler.h"
+#include "model_paths.h"
+
+using namespace tvm;
+using namespace ffi;
+
+using Scheduler = SegmentScheduler<SegmentRunner>;
+
+std::string readFileToString(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("파일을 열 수 없습니다: " + filePath);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();  // 전체 파일 내용을 스트림으로 읽기
+    return buffer.str();     // 문자열로 반환
+}
+
+int main(int argc, char* argv[]){
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
+  tvm::Device dev{kDLCUDA, 0};
+  std::string mode = "local";
+  int prefill_chunk_size = 64;
+  int mixed_token_budget = 0; // e.g. 256: decode steps of running jobs + prefill chunks per segment
+  bool async_admission = false; // Request of a released job on a worker thread
+  if(argc > 1) mixed_token_budget = std::stoi(argv[1]);
+  if(argc > 2) async_admission = std::string(argv[2]) == "async";
+
+  // - Cost model fitted by figure/fig_cost_model, refined online by every segment
+  auto cost_model = std::make_shared<CostModel>();
+  if(!cost_model->Load("../../figure/fig_cost_model/cost_model.txt")){
+    std::cout << "[debug] No fitted cost model, learning online only" << std::endl;
+  }
+
+  // - Task set: two periodic tasks with deadlines, one best-effort long generation
+  //   and a high-criticality operator query that preempts all of them
+  std::vector<Scheduler::TaskConfig> configs(4);
+
+  configs[0].name = "periodic-short";
+  configs[0].prompt = "Answer in one sentence. What is the capital of South Korea?";
+  configs[0].max_tokens = 32;
+  configs[0].period = std::chrono::milliseconds(2000);
+  configs[0].relative_deadline = std::chrono::milliseconds(1000);
+  configs[0].num_jobs = 5;
+
+  configs[1].name = "periodic-summary";
+  configs[1].prompt = "Summarize the benefits of real-time scheduling in three sentences.";
+  configs[1].max_tokens = 128;
+  configs[1].period = std::chrono::milliseconds(5000);
+  configs[1].relative_deadline = std::chrono::milliseconds(4000);
+  configs[1].offset = std::chrono::milliseconds(500);
+  configs[1].num_jobs = 2;
+  configs[1].execute_tokens = 4;
+
+  configs[2].name = "background";
+  configs[2].prompt = readFileToString("../../figure/fig_prefill_time/input.txt");
+  configs[2].prefill_chunks = 0; // large prefill chunks while idle, small ones near a deadline
+  configs[2].max_tokens = 1024;
+  configs[2].segment_budget = std::chrono::milliseconds(50); // pack decode steps into 50ms slots
+
+  configs[3].name = "operator";
+  configs[3].prompt = "Report the current status in one short sentence.";
+  configs[3].max_tokens = 16;
+  configs[3].offset = std::chrono::milliseconds(7000);
+  configs[3].relative_deadline = std::chrono::milliseconds(1000);
+  configs[3].priority = 1;
+
+  // One engine per task. SegmentRunner holds one live request, so a shared engine
+  // would be held by a job until it ends and block the tasks with deadlines behind it
+  // (the scheduler rejects that); separate engines are preempted at every segment boundary
+  std::vector<std::unique_ptr<SegmentRunner>> runners;
+  Scheduler scheduler;
+  scheduler.SetMixedTokenBudget(mixed_token_budget);
+  scheduler.SetAsyncAdmission(async_admission);
+  for(auto& config : configs){
+    runners.push_back(std::make_unique<SegmentRunner>());
+    runners.back()->Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
+    runners.back()->SetSeed(4542); // For same experiment
+    config.cost_model = cost_model;
+    config.prefill_chunk_size = prefill_chunk_size;
+    scheduler.AddTask(*runners.back(), config);
+  }
+  std::cout << "[debug] " << runners.size() << " engine(s) for " << configs.size() << " tasks" << std::endl;
+
+  scheduler.SetCompletionCallback([&configs](const Scheduler::JobResult& result){
+    auto response_time = std::chrono::duration<float, std::milli>(result.finish - result.release);
+    std::cout << "[" << configs[result.task_id].name << " #" << result.job_index << "] "
+              << "response time: " << response_time.count() << "ms, "
+              << "max token gap: " << result.max_token_gap.count() / 1000.0 << "ms"
+              << (result.deadline_missed ? " (DEADLINE MISS)" : "") << std::endl;
+  });
+  // Reported at the first segment boundary after the deadline, while the job is still running
+  scheduler.SetViolationCallback([&configs](const Scheduler::TimingViolation& violation){
+    if(violation.kind != Scheduler::ViolationKind::kDeadlineMiss) return;
+    std::cout << "[" << configs[violation.task_id].name << " #" << violation.job_index << "] "
+              << "deadline missed, " << violation.observed_us / 1000.0 << "ms after release" << std::endl;
+  });
+
+  // Park the long generation for a while from another thread; its KV cache stays
+  // resident on the device (no offload), so it continues without re-prefill after Resume
+  std::thread controller([&scheduler](){
+    std::this_thread::sleep_for(std::chrono::milliseconds(3000));
+    scheduler.Suspend(2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+    scheduler.Resume(2);
+  });
+
+  scheduler.Run();
+  controller.join();
+
+  int num_segments[3] = {0, 0, 0};
+  for(auto& segment : scheduler.segments()){
+    num_segments[static_cast<int>(segment.kind)]++;
+  }
+  std::cout << "===========================" << std::endl;
+  std::cout << "request segments: " << num_segments[0] << std::endl;
+  std::cout << "prefill segments: " << num_segments[1] << std::endl;
+  std::cout << "execute segments: " << num_segments[2] << std::endl;
+  std::cout << "mixed segments: " << scheduler.num_mixed_segments() << std::endl;
+
+  for(size_t i = 0; i < configs.size(); i++){
+    auto& stats = scheduler.priority_stats(i);
+    std::cout << "[" << configs[i].name << "] preempted: " << stats.preempted
+              << ", max ready latency: " << stats.max_ready_latency_us / 1000.0 << "ms"
+              << ", blocked by shared engine: " << stats.engine_blocked << " ("
+              << stats.total_engine_blocked_us / 1000.0 << "ms)" << std::endl;
+  }
+
+  Scheduler::SuspendStats suspend = scheduler.GetSuspendStats(2);
+  std::cout << "suspends: " << suspend.num_suspends << std::endl;
+  std::cout << "suspend latency: " << suspend.max_suspend_latency_us / 1000.0 << "ms" << std::endl;
+  std::cout << "resume latency: " << suspend.max_resume_latency_us / 1000.0 << "ms" << std::endl;
+  std::cout << "suspended: " << suspend.total_suspended_us / 1000.0 << "ms" << std::endl;
+
+  return 0;
+}
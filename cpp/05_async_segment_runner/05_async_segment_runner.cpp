@@ -0,0 +1,106 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+
+#include <serve/segment_runner/segment_runner.h>
+
+#include "async_segment_runner.h"
+#include "trace.h"
+#include "model_paths.h"
+
+using namespace tvm;
+using namespace ffi;
+
+std::string readFileToString(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("파일을 열 수 없습니다: " + filePath);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();  // 전체 파일 내용을 스트림으로 읽기
+    return buffer.str();     // 문자열로 반환
+}
+
+// Host-side work per segment: append, check stop strings and stream out
+bool postProcess(std::string& output, const std::string& delta, const std::string& stop){
+  SEGMENT_TRACE_SCOPE("postprocess", 0);
+  size_t from = output.size() > stop.size() ? output.size() - stop.size() : 0;
+  output += delta;
+  std::cout << delta << std::flush;
+  return stop.empty() || output.find(stop, from) == std::string::npos;
+}
+
+int main(int argc, char* argv[]){
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
+  tvm::Device dev{kDLCUDA, 0};
+  std::string mode = "local";
+  int prefill_chunk_size = 256;
+  int max_tokens = 256;
+  int execute_tokens = 1;
+  int depth = 2; // segments in flight
+  std::string stop = ""; // e.g. "\n\n"
+
+  if(argc > 1) execute_tokens = std::stoi(argv[1]);
+  if(argc > 2) depth = std::stoi(argv[2]);
+
+  SegmentRunner segment_runner;
+  segment_runner.Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
+  std::string prompt = readFileToString("../03_segment_runner/input.txt");
+  trace::SetThreadName("host");
+
+  // - Synchronous: device work and host post-processing alternate
+  segment_runner.SetSeed(4542); // For same experiment
+  segment_runner.Request(prompt, max_tokens);
+  while(!segment_runner.IsPrefillEnd()) segment_runner.Prefill(1);
+
+  std::string sync_output;
+  auto start = std::chrono::high_resolution_clock::now();
+  while(!segment_runner.IsEnd()){
+    std::string delta;
+    {
+      SEGMENT_TRACE_SCOPE("execute", 0);
+      delta = segment_runner.Execute(execute_tokens);
+    }
+    if(!postProcess(sync_output, delta, stop)) break;
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  auto sync_time = std::chrono::duration<float, std::milli>(end - start);
+  std::cout << std::endl;
+
+  // - Asynchronous: post-process segment k while segment k+1 runs on the device thread
+  std::string async_output;
+  int num_segments = 0;
+  {
+    segment_runner.SetSeed(4542);
+    AsyncSegmentRunner<SegmentRunner> async_runner(segment_runner);
+    async_runner.RequestAsync(prompt, max_tokens).get();
+    while(!async_runner.PrefillAsync(1).get().end){}
+
+    start = std::chrono::high_resolution_clock::now();
+    num_segments = async_runner.Stream(execute_tokens, depth, [&](const AsyncSegment& segment){
+      return postProcess(async_output, segment.output, stop);
+    });
+    end = std::chrono::high_resolution_clock::now();
+  }
+  auto async_time = std::chrono::duration<float, std::milli>(end - start);
+  std::cout << std::endl;
+
+  std::cout << "===========================" << std::endl;
+  std::cout << "segments: " << num_segments << std::endl;
+  std::cout << "sync execute: " << sync_time.count() << "ms" << std::endl;
+  std::cout << "async execute: " << async_time.count() << "ms" << std::endl;
+  if(sync_output != async_output){
+    std::cout << "[ERROR] Outputs differ between sync and async runs" << std::endl;
+  }
+
+  trace::ExportChromeJSON("trace.json");
+
+  return 0;
+}
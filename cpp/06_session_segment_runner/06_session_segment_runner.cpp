@@ -0,0 +1,87 @@
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <serve/segment_runner/segment_runner.h>
+
+#include "session_segment_runner.h"
+#include "model_paths.h"
+
+using namespace tvm;
+using namespace ffi;
+
+int main(int argc, char* argv[]){
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
+  tvm::Device dev{kDLCUDA, 0};
+  std::string mode = "local";
+  int prefill_chunk_size = 64;
+  int max_tokens = 128;
+
+  SegmentRunner segment_runner;
+  segment_runner.Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
+  segment_runner.SetSeed(4542); // For same experiment
+
+  SessionSegmentRunner<SegmentRunner>::Limits limits;
+  limits.max_sessions = 4;
+  limits.max_context_chars = 8192;
+  limits.system_message = "You are a helpful assistant.";
+  SessionSegmentRunner<SegmentRunner> session_runner(segment_runner, limits);
+  int session = session_runner.Open();
+
+  std::vector<std::string> turns = {
+    "Can you introduce yourself?",
+    "What can you help me with when I write C++ code?",
+    "Summarize our conversation so far in one sentence.",
+    "Now answer the first question again, but shorter.",
+  };
+
+  // Prefill time per turn against the size of the dialog. SegmentRunner only takes a
+  // prompt it templates as one user turn, so it gets the new user text alone: the
+  // model does not see earlier turns and no prefix is reused
+  std::cout << "[debug] dialog sent to the engine: "
+            << (SessionSegmentRunner<SegmentRunner>::kSendsDialog ? "yes" : "no, new user text only") << std::endl;
+  std::vector<float> prefill_ms;
+  std::vector<size_t> dialog_chars;
+  for(auto& user_text : turns){
+    dialog_chars.push_back(session_runner.Transcript(session).size());
+    auto start = std::chrono::high_resolution_clock::now();
+    session_runner.AppendTurn(session, user_text, max_tokens);
+    while(!session_runner.IsPrefillEnd()) session_runner.Prefill(1);
+    auto prefill_end = std::chrono::high_resolution_clock::now();
+
+    std::string output;
+    while(!session_runner.IsEnd()) output += session_runner.Execute(1);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    prefill_ms.push_back(std::chrono::duration<float, std::milli>(prefill_end - start).count());
+    auto& stats = session_runner.stats(session);
+    std::cout << "USER: " << user_text << std::endl;
+    std::cout << "ASSISTANT: " << output << std::endl;
+    std::cout << "prefill: " << std::chrono::duration<float, std::milli>(prefill_end - start).count() << "ms" << std::endl;
+    std::cout << "execute: " << std::chrono::duration<float, std::milli>(end - prefill_end).count() << "ms" << std::endl;
+    std::cout << "[debug] turn " << stats.turns << ", prefill segments: " << stats.last_prefill_segments
+              << ", context chars: " << stats.context_chars << ", evicted turns: " << stats.evicted_turns << std::endl;
+  }
+
+  std::cerr << "===========================" << std::endl;
+  std::cerr << "turn  dialog chars  prefill ms" << std::endl;
+  for(size_t i = 0; i < prefill_ms.size(); i++){
+    std::cerr << std::setw(4) << i + 1 << std::setw(14) << dialog_chars[i] << std::setw(12) << std::fixed
+              << std::setprecision(3) << prefill_ms[i] << std::endl;
+  }
+  // Turn 1 has no reusable prefix; compare the later turns with turn 2
+  if(prefill_ms.size() > 2){
+    std::cerr << "prefill growth (last turn / turn 2): " << prefill_ms.back() / prefill_ms[1]
+              << ", dialog growth: " << static_cast<float>(dialog_chars.back()) / dialog_chars[1] << std::endl;
+  }
+
+  session_runner.Close(session);
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <serve/segment_runner/segment_runner.h>
+#include <tokenizers/tokenizers.h>
+
+#include "cost_model.h"
+#include "rt_analysis.h"
+#include "segment_scheduler.h"
+#include "session_segment_runner.h"
+#include "tokenizer_service.h"
+#include "model_paths.h"
+
+using namespace tvm;
+using namespace ffi;
+
+using Scheduler = SegmentScheduler<SegmentRunner>;
+
+std::string readFileToString(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("파일을 열 수 없습니다: " + filePath);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();  // 전체 파일 내용을 스트림으로 읽기
+    return buffer.str();     // 문자열로 반환
+}
+
+struct RtTask {
+  Scheduler::TaskConfig config;
+  int prompt_tokens = 0; // the prompt in the chat template, tokenized below
+};
+
+int main(int argc, char* argv[]){
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
+  tvm::Device dev{kDLCUDA, 0};
+  std::string mode = "local";
+  int prefill_chunk_size = 64;
+  int64_t request_overhead_us = 4000; // worst "request time" of evaluation/02_cpp_segment_runner, rounded up
+
+  CostModel cost_model;
+  if(!cost_model.Load("../../figure/fig_cost_model/cost_model.txt")){
+    std::cout << "[ERROR] No fitted cost model, run figure/fig_cost_model first" << std::endl;
+    exit(0);
+  }
+
+  // - Task set: period, deadline and a bounded job (max_tokens) per task
+  std::vector<RtTask> tasks(3);
+
+  tasks[0].config.name = "periodic-short";
+  tasks[0].config.prompt = "Answer in one sentence. What is the capital of South Korea?";
+  tasks[0].config.max_tokens = 32;
+  tasks[0].config.period = std::chrono::milliseconds(2000);
+  tasks[0].config.relative_deadline = std::chrono::milliseconds(1500);
+  tasks[0].config.num_jobs = 5;
+
+  tasks[1].config.name = "periodic-summary";
+  tasks[1].config.prompt = "Summarize the benefits of real-time scheduling in three sentences.";
+  tasks[1].config.max_tokens = 128;
+  tasks[1].config.period = std::chrono::milliseconds(5000);
+  tasks[1].config.relative_deadline = std::chrono::milliseconds(4000);
+  tasks[1].config.num_jobs = 2;
+  tasks[1].config.execute_tokens = 4;
+
+  tasks[2].config.name = "background";
+  tasks[2].config.prompt = readFileToString("../../figure/fig_prefill_time/input.txt");
+  tasks[2].config.max_tokens = 1024;
+
+  // - Prompt lengths as the engine prefills them: each prompt as a user turn of
+  //   the chat template, encoded with the model tokenizer
+  {
+    TokenizerService tokenizer_service([&model_dir](int){
+      mlc::llm::Tokenizer tokenizer = mlc::llm::Tokenizer::FromPath(model_dir);
+      return [tokenizer](const std::string& text){ return tokenizer->Encode(text); };
+    });
+    ChatTemplate chat_template;
+    std::vector<std::string> rendered;
+    for(auto& task : tasks) rendered.push_back(chat_template.Render({{"user", task.config.prompt}}));
+    std::vector<TokenizerService::TokenVec> encoded = tokenizer_service.EncodeBatch(rendered);
+    for(size_t i = 0; i < tasks.size(); i++){
+      tasks[i].prompt_tokens = static_cast<int>(encoded[i].size());
+      std::cout << "[debug] " << tasks[i].config.name << " prompt tokens: " << tasks[i].prompt_tokens << std::endl;
+    }
+  }
+
+  // - Offline analysis: admit the task set only if every deadline is guaranteed
+  std::vector<RtTaskSpec> specs;
+  for(auto& task : tasks){
+    RtTaskSpec spec;
+    spec.name = task.config.name;
+    spec.period_us = task.config.period.count();
+    spec.deadline_us = task.config.relative_deadline.count();
+    spec.priority = task.config.priority;
+    spec.segment_wcet_us = SegmentWcetFromCostModel(cost_model, request_overhead_us, task.prompt_tokens,
+                                                    prefill_chunk_size, task.config.prefill_chunks,
+                                                    task.config.max_tokens, task.config.execute_tokens);
+    task.config.segment_wcet_us = spec.segment_wcet_us; // runtime monitor
+    specs.push_back(spec);
+  }
+
+  SchedulabilityResult analysis = AnalyzeEdf(specs);
+  for(auto& report : analysis.tasks){
+    std::cout << "[" << report.name << "] WCET: " << report.wcet_us / 1000.0 << "ms, "
+              << "max segment: " << report.max_segment_us / 1000.0 << "ms, "
+              << "utilization: " << report.utilization << std::endl;
+  }
+  std::cout << "utilization: " << analysis.utilization << std::endl;
+  if(!analysis.schedulable){
+    std::cout << "[ERROR] Task set rejected: " << analysis.reason << std::endl;
+    exit(0);
+  }
+  std::cout << "[debug] Task set admitted, min slack: " << analysis.min_slack_us / 1000.0 << "ms" << std::endl;
+
+  // - Run with the runtime monitor
+  std::vector<std::unique_ptr<SegmentRunner>> runners;
+  Scheduler scheduler;
+  for(auto& task : tasks){
+    runners.push_back(std::make_unique<SegmentRunner>());
+    runners.back()->Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
+    runners.back()->SetSeed(4542); // For same experiment
+    task.config.prefill_chunk_size = prefill_chunk_size;
+    scheduler.AddTask(*runners.back(), task.config);
+  }
+
+  scheduler.SetViolationCallback([&tasks](const Scheduler::TimingViolation& violation){
+    std::cout << "[MONITOR] " << tasks[violation.task_id].config.name << " #" << violation.job_index << " ";
+    if(violation.kind == Scheduler::ViolationKind::kDeadlineMiss){
+      std::cout << "deadline miss: ";
+    } else{
+      std::cout << "segment " << violation.segment_index << " overrun: ";
+    }
+    std::cout << violation.observed_us / 1000.0 << "ms > " << violation.bound_us / 1000.0 << "ms" << std::endl;
+  });
+
+  scheduler.Run();
+
+  std::cout << "===========================" << std::endl;
+  std::cout << "jobs: " << scheduler.results().size() << std::endl;
+  std::cout << "violations: " << scheduler.violations().size() << std::endl;
+
+  return 0;
+}
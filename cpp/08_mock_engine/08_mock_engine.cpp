@@ -0,0 +1,112 @@
+
+
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "mock_engine.h"
+#include "latency_histogram.h"
+
+// Concurrent clients against the mock threaded engine, wired the way
+// CppInterface drives the real one: a background loop thread, a stream-back
+// thread and a callback that routes outputs to the waiting request.
+struct RequestState {
+  std::chrono::steady_clock::time_point submitted;
+  std::vector<std::chrono::steady_clock::time_point> token_times;
+  std::string finish_reason;
+  bool done = false;
+};
+
+int main(int argc, char* argv[]){
+  // ./08_mock_engine [num requests] [max batch] (latency model: MOCK_* env, see mock_engine.h)
+  int num_requests = 16;
+  int max_num_sequence = 4;
+  if(argc > 1) num_requests = atoi(argv[1]);
+  if(argc > 2) max_num_sequence = atoi(argv[2]);
+
+  MockThreadedEngine engine;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::unordered_map<std::string, RequestState> states;
+
+  engine.InitThreadedEngine([&](const std::vector<MockStreamOutput>& outputs){
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mtx);
+    for(const MockStreamOutput& output : outputs){
+      RequestState& state = states[output.request_id];
+      for(size_t i = 0; i < output.delta_token_ids.size(); i++) state.token_times.push_back(now);
+      if(output.finish_reason.has_value()) state.finish_reason = output.finish_reason.value();
+      if(output.request_final_usage_json_str.has_value()) state.done = true;
+    }
+    cv.notify_all();
+  });
+
+  std::thread background_loop_thread([&engine](){ engine.RunBackgroundLoop(); });
+  std::thread background_stream_back_loop_thread([&engine](){ engine.RunBackgroundStreamBackLoop(); });
+
+  MockEngineConfig config;
+  config.max_num_sequence = max_num_sequence;
+  config.prefill_chunk_size = 64;
+  engine.Reload(config);
+
+  std::string prompt(600, 'x');
+  std::vector<std::thread> clients;
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < num_requests; i++){
+    clients.emplace_back([&, i](){
+      std::this_thread::sleep_for(std::chrono::milliseconds(5 * i));
+      std::string request_id = "mock-" + std::to_string(i);
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        states[request_id].submitted = std::chrono::steady_clock::now();
+      }
+      engine.AddRequest(engine.CreateRequest(request_id, prompt, 32 + 8 * (i % 4)));
+
+      // - The last client gives up after its first few tokens
+      std::unique_lock<std::mutex> lock(mtx);
+      if(i == num_requests - 1){
+        cv.wait(lock, [&](){ return states[request_id].token_times.size() >= 4 || states[request_id].done; });
+        lock.unlock();
+        engine.AbortRequest(request_id);
+        lock.lock();
+      }
+      cv.wait(lock, [&](){ return states[request_id].done; });
+    });
+  }
+  for(auto& client : clients) client.join();
+  auto end = std::chrono::steady_clock::now();
+
+  engine.ExitBackgroundLoop();
+  background_loop_thread.join();
+  background_stream_back_loop_thread.join();
+
+  LatencyHistogram ttft;
+  LatencyHistogram itl;
+  size_t num_tokens = 0;
+  int num_aborted = 0;
+  for(auto& [request_id, state] : states){
+    num_tokens += state.token_times.size();
+    if(state.finish_reason == "abort") num_aborted++;
+    if(state.token_times.empty()) continue;
+    ttft.Record(state.token_times.front() - state.submitted);
+    for(size_t t = 1; t < state.token_times.size(); t++) itl.Record(state.token_times[t] - state.token_times[t - 1]);
+  }
+
+  MockThreadedEngine::Stats stats = engine.stats();
+  std::cout << "requests: " << num_requests << " (aborted " << num_aborted << "), tokens: " << num_tokens << std::endl;
+  std::cout << "prefill steps: " << stats.prefill_steps << ", decode steps: " << stats.decode_steps
+            << ", max batch: " << stats.max_batch << std::endl;
+  std::cout << "wall time: " << std::chrono::duration<float, std::milli>(end - start).count() << "ms" << std::endl;
+  LatencyRecorder::PrintHistogram(std::cout, "TTFT", ttft);
+  LatencyRecorder::PrintHistogram(std::cout, "inter-token time", itl);
+
+  return 0;
+}
@@ -0,0 +1,5 @@
+g++ -std=c++20 \
+    -o 08_mock_engine 08_mock_engine.cpp \
+    -I../common \
+    -I../mock \
+    -lpthread
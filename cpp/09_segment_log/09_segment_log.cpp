@@ -0,0 +1,103 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "segment_log.h"
+#include "mock_engine.h"
+
+// Cost per debug message on the calling thread: an [engine debug] style
+// std::cout line (to a file, so the terminal is not measured) against a
+// SEGMENT_LOG_DEBUG record. Then the mock engine runs with its debug log
+// written to segment_log.bin; read it with
+//   ./segment_log_decode segment_log.bin
+// build.sh compiles debug messages in; at the default level (info) the
+// SEGMENT_LOG_DEBUG loop compiles to nothing.
+double measureStream(std::ostream& out, int n){
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < n; i++){
+    out << "[engine debug] decode batch " << 4 << " max context " << 600 + i
+        << " available pages " << 1024 - i % 1024 << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+double measureSegmentLog(int n){
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < n; i++){
+    SEGMENT_LOG_DEBUG("decode batch {} max context {} available pages {}", 4, 600 + i, 1024 - i % 1024);
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+int main(int argc, char* argv[]){
+  // ./09_segment_log [log path] [messages]
+  std::string path = "segment_log.bin";
+  int n = 10000;
+  if(argc > 1) path = argv[1];
+  if(argc > 2) n = atoi(argv[2]);
+  if(n > SEGMENT_LOG_RING_SIZE) n = SEGMENT_LOG_RING_SIZE;  // no drops while measuring
+
+  seglog::Logger& logger = seglog::Logger::Get();
+  if(!logger.Open(path)){
+    std::cout << "[ERROR] Cannot open " << path << std::endl;
+    exit(0);
+  }
+  logger.SetThreadName("main");
+
+  std::ofstream stream_log("segment_log_stream.txt");
+  measureStream(stream_log, 100);
+  measureSegmentLog(100);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));  // let the drain thread empty the ring
+
+  double stream_ns = measureStream(stream_log, n);
+  double segment_log_ns = measureSegmentLog(n);
+  std::cout << "std::cout + std::endl : " << stream_ns << " ns/message" << std::endl;
+  std::cout << "SEGMENT_LOG_DEBUG     : " << segment_log_ns << " ns/message" << std::endl;
+
+  // Mock engine with its per-step debug log
+  MockThreadedEngine engine;
+  std::mutex mtx;
+  std::condition_variable cv;
+  int done = 0;
+  engine.InitThreadedEngine([&](const std::vector<MockStreamOutput>& outputs){
+    std::lock_guard<std::mutex> lock(mtx);
+    for(const MockStreamOutput& output : outputs){
+      if(output.request_final_usage_json_str.has_value()) done++;
+    }
+    cv.notify_all();
+  });
+  std::thread background_loop_thread([&](){
+    logger.SetThreadName("engine");
+    engine.RunBackgroundLoop();
+  });
+  std::thread background_stream_back_loop_thread([&engine](){ engine.RunBackgroundStreamBackLoop(); });
+
+  MockEngineConfig config;
+  config.max_num_sequence = 4;
+  config.prefill_chunk_size = 64;
+  engine.Reload(config);
+
+  int num_requests = 4;
+  for(int i = 0; i < num_requests; i++){
+    engine.AddRequest(engine.CreateRequest("request-" + std::to_string(i), std::string(200, 'x'), 32));
+    SEGMENT_LOG_INFO("request {} added", i);
+  }
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [&]{ return done == num_requests; });
+  }
+  engine.ExitBackgroundLoop();
+  background_loop_thread.join();
+  background_stream_back_loop_thread.join();
+
+  logger.Close();
+  std::cout << "Log written to " << path << std::endl;
+  return 0;
+}
@@ -0,0 +1,10 @@
+g++ -std=c++20 -O2 \
+    -o 09_segment_log 09_segment_log.cpp \
+    -DSEGMENT_LOG_LEVEL=SEGMENT_LOG_LEVEL_DEBUG \
+    -I../common \
+    -I../mock \
+    -lpthread
+
+g++ -std=c++20 -O2 \
+    -o segment_log_decode segment_log_decode.cpp \
+    -I../common
@@ -0,0 +1,163 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+
+#include "segment_log.h"
+
+// Prints a segment_log.h binary log as text, one line per record:
+//   +12.345678ms [DEBUG] [engine] mock_engine.h:290 decode batch 4 ...
+// ./segment_log_decode <log> [--level trace|debug|info|warning|error] [--site]
+struct SiteInfo {
+  uint8_t level = 0;
+  int32_t line = 0;
+  std::string file;
+  std::string format;
+};
+
+template <typename T>
+bool readValue(std::ifstream& in, T& value){
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool readString(std::ifstream& in, std::string& s){
+  uint16_t len = 0;
+  if(!readValue(in, len)) return false;
+  s.resize(len);
+  return static_cast<bool>(in.read(s.data(), len));
+}
+
+int parseLevel(const std::string& name){
+  for(int level = seglog::kTrace; level <= seglog::kError; level++){
+    std::string level_name = seglog::LevelName(level);
+    std::string lower;
+    for(char c : level_name) lower += static_cast<char>(tolower(c));
+    if(name == lower || name == level_name) return level;
+  }
+  std::cout << "[ERROR] Unknown level: " << name << std::endl;
+  exit(0);
+}
+
+std::string formatRecord(const std::string& format, const seglog::Record& record){
+  std::ostringstream out;
+  int arg = 0;
+  for(size_t i = 0; i < format.size(); i++){
+    if(format[i] == '{' && i + 1 < format.size() && format[i + 1] == '}' && arg < record.num_args){
+      if(record.float_mask & (1u << arg)){
+        double d;
+        std::memcpy(&d, &record.args[arg], sizeof(d));
+        out << d;
+      }
+      else out << record.args[arg];
+      arg++;
+      i++;
+    }
+    else out << format[i];
+  }
+  return out.str();
+}
+
+std::string baseName(const std::string& path){
+  size_t pos = path.find_last_of('/');
+  return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+int main(int argc, char* argv[]){
+  if(argc < 2){
+    std::cout << "Usage: " << argv[0] << " <log> [--level trace|debug|info|warning|error] [--site]" << std::endl;
+    return 0;
+  }
+  std::string path = argv[1];
+  int min_level = seglog::kTrace;
+  bool print_site = false;
+  for(int i = 2; i < argc; i++){
+    std::string arg = argv[i];
+    if(arg == "--level" && i + 1 < argc) min_level = parseLevel(argv[++i]);
+    else if(arg == "--site") print_site = true;
+    else{
+      std::cout << "[ERROR] Unknown option: " << arg << std::endl;
+      exit(0);
+    }
+  }
+
+  std::ifstream in(path, std::ios::binary);
+  if(!in.is_open()){
+    std::cout << "[ERROR] Cannot open " << path << std::endl;
+    exit(0);
+  }
+  char magic[8];
+  int64_t start_ns = 0, wall_ns = 0;
+  if(!in.read(magic, 8) || std::memcmp(magic, "SEGLOG02", 8) != 0 || !readValue(in, start_ns) || !readValue(in, wall_ns)){
+    std::cout << "[ERROR] Not a segment log: " << path << std::endl;
+    exit(0);
+  }
+
+  std::vector<SiteInfo> sites;
+  std::map<uint32_t, std::string> threads;
+  std::map<uint32_t, uint64_t> dropped;
+  uint64_t num_records = 0;
+  std::cout << std::fixed;
+
+  char tag;
+  while(in.get(tag)){
+    bool ok = true;
+    if(tag == 'S'){
+      uint32_t id;
+      SiteInfo site;
+      ok = readValue(in, id) && readValue(in, site.level) && readValue(in, site.line) &&
+           readString(in, site.file) && readString(in, site.format);
+      if(ok){
+        if(sites.size() <= id) sites.resize(id + 1);
+        sites[id] = site;
+      }
+    }
+    else if(tag == 'T'){
+      uint32_t tid;
+      std::string name;
+      ok = readValue(in, tid) && readString(in, name);
+      if(ok) threads[tid] = name;
+    }
+    else if(tag == 'D'){
+      uint32_t tid;
+      uint64_t count;
+      ok = readValue(in, tid) && readValue(in, count);
+      if(ok) dropped[tid] += count;
+    }
+    else if(tag == 'R'){
+      seglog::Record record;
+      ok = readValue(in, record);
+      if(!ok) break;
+      num_records++;
+      if(record.site >= sites.size()){
+        std::cout << "[ERROR] Record refers to unknown site " << record.site << std::endl;
+        continue;
+      }
+      const SiteInfo& site = sites[record.site];
+      if(site.level < min_level) continue;
+      std::cout << "+" << std::setprecision(6) << (record.ns - start_ns) / 1e6 << "ms ["
+                << seglog::LevelName(site.level) << "] [" << threads[record.tid] << "] ";
+      if(print_site) std::cout << baseName(site.file) << ":" << site.line << " ";
+      std::cout << formatRecord(site.format, record) << std::endl;
+    }
+    else{
+      std::cout << "[ERROR] Corrupt log at offset " << static_cast<long long>(in.tellg()) - 1 << std::endl;
+      break;
+    }
+    if(!ok){
+      std::cout << "[ERROR] Truncated log" << std::endl;
+      break;
+    }
+  }
+
+  std::cout << "# " << num_records << " records" << std::endl;
+  for(const auto& [tid, count] : dropped){
+    std::cout << "# " << count << " records dropped on " << threads[tid] << " (ring full)" << std::endl;
+  }
+  return 0;
+}
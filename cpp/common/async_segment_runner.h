@@ -0,0 +1,168 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "trace.h"
+
+struct AsyncSegment {
+  std::string output;     // decoded text (Execute only)
+  bool end = false;       // IsPrefillEnd() after Prefill, IsEnd() after Execute
+  bool cancelled = false; // dropped by Cancel() before it started
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point finish;
+};
+
+// Asynchronous segments on top of a SegmentRunner-like `Runner`.
+//
+// A device thread owns the runner and runs submitted segments in order, so
+// the caller can post-process segment k (append, match stop strings, stream)
+// while segment k+1 is already running. Once the wrapper is constructed the
+// runner must only be used through it.
+//
+// Segments submitted after the sequence ended do not call the runner and
+// return with `end` set. Cancel() drops the segments that have not started
+// yet; their futures resolve with `cancelled` set.
+template <typename Runner>
+class AsyncSegmentRunner {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit AsyncSegmentRunner(Runner& runner, uint16_t trace_track = 0)
+      : runner_(runner), trace_track_(trace_track), worker_([this] { Loop(); }) {}
+
+  ~AsyncSegmentRunner() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+  }
+
+  AsyncSegmentRunner(const AsyncSegmentRunner&) = delete;
+  AsyncSegmentRunner& operator=(const AsyncSegmentRunner&) = delete;
+
+  std::future<AsyncSegment> RequestAsync(const std::string& prompt, int max_tokens) {
+    return Submit([this, prompt, max_tokens](AsyncSegment& segment) {
+      SEGMENT_TRACE_SCOPE("request", trace_track_);
+      runner_.Request(prompt, max_tokens);
+      segment.end = runner_.IsPrefillEnd();
+    });
+  }
+
+  std::future<AsyncSegment> PrefillAsync(int n) {
+    return Submit([this, n](AsyncSegment& segment) {
+      if (!runner_.IsPrefillEnd()) {
+        SEGMENT_TRACE_SCOPE("prefill", trace_track_);
+        runner_.Prefill(n);
+      }
+      segment.end = runner_.IsPrefillEnd();
+    });
+  }
+
+  std::future<AsyncSegment> ExecuteAsync(int n) {
+    return Submit([this, n](AsyncSegment& segment) {
+      if (!runner_.IsEnd()) {
+        SEGMENT_TRACE_SCOPE("execute", trace_track_);
+        segment.output = runner_.Execute(n);
+      }
+      segment.end = runner_.IsEnd();
+    });
+  }
+
+  // Decode to the end with up to `depth` Execute(n) segments in flight.
+  // `on_segment` runs on the calling thread for every finished segment, in
+  // order, while the next ones run on the device; returning false stops the
+  // stream and cancels what is still queued. Returns the number of segments
+  // handed to `on_segment`.
+  int Stream(int n, int depth, const std::function<bool(const AsyncSegment&)>& on_segment) {
+    std::deque<std::future<AsyncSegment>> in_flight;
+    for (int i = 0; i < depth; ++i) in_flight.push_back(ExecuteAsync(n));
+    int count = 0;
+    while (!in_flight.empty()) {
+      AsyncSegment segment = in_flight.front().get();
+      in_flight.pop_front();
+      if (segment.cancelled) continue;
+      if (!segment.end) in_flight.push_back(ExecuteAsync(n));
+      count++;
+      bool more = on_segment(segment);
+      if (!more || segment.end) {
+        Cancel();
+        for (auto& pending : in_flight) pending.wait();
+        break;
+      }
+    }
+    return count;
+  }
+
+  void Cancel() {
+    std::deque<Job> dropped;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      dropped.swap(queue_);
+    }
+    for (Job& job : dropped) {
+      AsyncSegment segment;
+      segment.cancelled = true;
+      job.promise.set_value(std::move(segment));
+    }
+  }
+
+private:
+  struct Job {
+    std::function<void(AsyncSegment&)> run;
+    std::promise<AsyncSegment> promise;
+  };
+
+  std::future<AsyncSegment> Submit(std::function<void(AsyncSegment&)> run) {
+    Job job{std::move(run), {}};
+    std::future<AsyncSegment> future = job.promise.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      queue_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+    return future;
+  }
+
+  void Loop() {
+    trace::SetThreadName("segment-device");
+    while (true) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        job = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      AsyncSegment segment;
+      segment.start = Clock::now();
+      try {
+        job.run(segment);
+      } catch (...) {
+        job.promise.set_exception(std::current_exception());
+        continue;
+      }
+      segment.finish = Clock::now();
+      job.promise.set_value(std::move(segment));
+    }
+  }
+
+  Runner& runner_;
+  uint16_t trace_track_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<Job> queue_;
+  bool stop_ = false;
+  std::thread worker_;  // last: starts after the members above are initialized
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Latency cost model for prefill chunks and decode steps.
+//
+// The profiles in figure/fig_prefill_time and figure/fig_execute_time show
+//   prefill chunk:  t ~ a + b * chunk + c * pos + d * chunk * pos
+//   decode step:    t ~ a + c * ctx_len
+// where `pos` is the number of tokens already in the KV cache. Every profile
+// and runner decodes a single sequence, so the decode curve has no batch
+// terms; with batch 1 only they are collinear with the intercept. Each curve is
+// a small linear model fitted with recursive least squares
+// and a forgetting factor, so it can be seeded from profiler output and then
+// keep tracking live timings. Predictions carry an error bound derived from
+// the residuals of the fitted curve (measured after each update, once a
+// warmup has passed, so the large errors of the unconverged fit do not
+// count) and from the coefficient uncertainty at the predicted point.
+class CostModel {
+public:
+  struct Prediction {
+    double mean_us = 0.0;
+    double bound_us = 0.0;   // mean + z * stddev
+    double worst_us = 0.0;   // mean + max(z * stddev, largest (slowly decaying) underprediction seen)
+    double stddev_us = 0.0;  // residual stddev widened by the coefficient uncertainty, sqrt(s^2 (1 + x'Px))
+  };
+
+  explicit CostModel(double z = 3.0, double forgetting = 0.999)
+      : z_(z), prefill_(forgetting), decode_(forgetting) {}
+
+  Prediction PredictPrefillUs(int pos, int chunk) const {
+    return prefill_.Predict(PrefillFeatures(pos, chunk), z_);
+  }
+
+  Prediction PredictDecodeUs(int ctx_len) const { return decode_.Predict(DecodeFeatures(ctx_len), z_); }
+
+  void ObservePrefill(int pos, int chunk, double us) { prefill_.Update(PrefillFeatures(pos, chunk), us); }
+  void ObserveDecode(int ctx_len, double us) { decode_.Update(DecodeFeatures(ctx_len), us); }
+
+  bool HasPrefillSamples() const { return prefill_.num_samples > 0; }
+  bool HasDecodeSamples() const { return decode_.num_samples > 0; }
+
+  // Seed from `profile_prefill_time` output ("prefill: 32ms" per chunk).
+  // Request runs chunk 0, so the first sample is the chunk at `chunk`. The
+  // last chunk of a prompt is partial and is skipped. Returns the number of
+  // samples used.
+  int FitPrefillFromProfile(const std::string& path, int chunk) {
+    std::vector<double> values = ReadProfileValues(path, "prefill");
+    if (!values.empty()) values.pop_back();
+    int n = 0;
+    for (double ms : values) {
+      ObservePrefill((n + 1) * chunk, chunk, ms * 1000.0);
+      n++;
+    }
+    return n;
+  }
+
+  // Seed from `profile_execute_time` output ("execute: 14ms" per token).
+  // The context length starts at `input_length`, or at the value found in a
+  // "[debug] input token length: N" line when `input_length` is negative.
+  int FitDecodeFromProfile(const std::string& path, int input_length = -1) {
+    if (input_length < 0) input_length = ReadInputLength(path);
+    int n = 0;
+    for (double ms : ReadProfileValues(path, "execute")) {
+      ObserveDecode(input_length + n, ms * 1000.0);
+      n++;
+    }
+    return n;
+  }
+
+  // Plain-text persistence: one line per curve with coefficients and residual stats.
+  bool Save(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    out.precision(17);
+    out << "prefill " << prefill_.ToString() << "\n";
+    out << "decode " << decode_.ToString() << "\n";
+    return true;
+  }
+
+  bool Load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream iss(line);
+      std::string name;
+      iss >> name;
+      if (name == "prefill") prefill_.FromStream(iss);
+      if (name == "decode") decode_.FromStream(iss);
+    }
+    return true;
+  }
+
+  // Coefficients in microseconds for the unscaled features.
+  std::vector<double> PrefillCoefficients() const { return prefill_.Unscale(kPrefillScale); }
+  std::vector<double> DecodeCoefficients() const { return decode_.Unscale(kDecodeScale); }
+
+  static std::vector<double> ReadProfileValues(const std::string& path, const std::string& key) {
+    std::vector<double> values;
+    std::ifstream in(path);
+    std::string line;
+    std::string prefix = key + ":";
+    while (std::getline(in, line)) {
+      if (line.rfind(prefix, 0) != 0) continue;
+      try {
+        values.push_back(std::stod(line.substr(prefix.size())));
+      } catch (const std::exception&) {
+      }
+    }
+    return values;
+  }
+
+private:
+  static constexpr int kPrefillDim = 4;
+  static constexpr int kDecodeDim = 2;
+  // Feature scales keep the RLS covariance well conditioned.
+  static constexpr double kPrefillScale[kPrefillDim] = {1.0, 1.0 / 64.0, 1.0 / 1024.0, 1.0 / (64.0 * 1024.0)};
+  static constexpr double kDecodeScale[kDecodeDim] = {1.0, 1.0 / 1024.0};
+
+  static std::array<double, kPrefillDim> PrefillFeatures(int pos, int chunk) {
+    return {kPrefillScale[0], chunk * kPrefillScale[1], pos * kPrefillScale[2],
+            static_cast<double>(chunk) * pos * kPrefillScale[3]};
+  }
+
+  static std::array<double, kDecodeDim> DecodeFeatures(int ctx_len) {
+    return {kDecodeScale[0], ctx_len * kDecodeScale[1]};
+  }
+
+  static int ReadInputLength(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    const std::string key = "input token length:";
+    while (std::getline(in, line)) {
+      size_t at = line.find(key);
+      if (at != std::string::npos) return std::stoi(line.substr(at + key.size()));
+    }
+    return 0;
+  }
+
+  // Recursive least squares with exponential forgetting.
+  template <int kDim>
+  struct Curve {
+    using Features = std::array<double, kDim>;
+    // Samples before the residual statistics start.
+    static constexpr long kWarmupSamples = 20;
+
+    explicit Curve(double forgetting) : lambda(forgetting) {
+      for (int i = 0; i < kDim; ++i) {
+        w[i] = 0.0;
+        for (int j = 0; j < kDim; ++j) P[i][j] = i == j ? 1e6 : 0.0;
+      }
+    }
+
+    Prediction Predict(const Features& x, double z) const {
+      Prediction p;
+      double mean = 0.0;
+      double xpx = 0.0;
+      for (int i = 0; i < kDim; ++i) {
+        mean += w[i] * x[i];
+        for (int j = 0; j < kDim; ++j) xpx += x[i] * P[i][j] * x[j];
+      }
+      double stddev = std::sqrt(std::max(0.0, residual_var) * (1.0 + std::max(0.0, xpx)));
+      p.mean_us = std::max(0.0, mean);
+      p.stddev_us = stddev;
+      p.bound_us = p.mean_us + z * stddev;
+      p.worst_us = p.mean_us + std::max(z * stddev, max_residual);
+      return p;
+    }
+
+    void Update(const Features& x, double y) {
+      // k = P x / (lambda + x' P x)
+      double px[kDim];
+      double denom = lambda;
+      for (int i = 0; i < kDim; ++i) {
+        px[i] = 0.0;
+        for (int j = 0; j < kDim; ++j) px[i] += P[i][j] * x[j];
+        denom += x[i] * px[i];
+      }
+      double err = y;
+      for (int i = 0; i < kDim; ++i) err -= w[i] * x[i];
+      for (int i = 0; i < kDim; ++i) w[i] += px[i] / denom * err;
+      // P = (P - k x' P) / lambda
+      for (int i = 0; i < kDim; ++i) {
+        for (int j = 0; j < kDim; ++j) P[i][j] = (P[i][j] - px[i] * px[j] / denom) / lambda;
+      }
+      num_samples++;
+
+      // Residual statistics on a-posteriori errors of the updated curve,
+      // weighted with the same forgetting as the coefficients, so they
+      // describe the current fit and not the order the samples came in.
+      long m = num_samples - kWarmupSamples;
+      if (m <= 0) return;
+      double residual = y;
+      for (int i = 0; i < kDim; ++i) residual -= w[i] * x[i];
+      double weight = lambda < 1.0 ? (1.0 - std::pow(lambda, m - 1)) / (1.0 - lambda) : m - 1.0;  // of earlier residuals
+      residual_var = (lambda * weight * residual_var + residual * residual) / (lambda * weight + 1.0);
+      max_residual = std::max(max_residual * lambda, residual);
+    }
+
+    std::vector<double> Unscale(const double* scale) const {
+      std::vector<double> out(kDim);
+      for (int i = 0; i < kDim; ++i) out[i] = w[i] * scale[i];
+      return out;
+    }
+
+    std::string ToString() const {
+      std::ostringstream oss;
+      oss.precision(17);
+      oss << num_samples << " " << residual_var << " " << max_residual;
+      for (int i = 0; i < kDim; ++i) oss << " " << w[i];
+      for (int i = 0; i < kDim; ++i)
+        for (int j = 0; j < kDim; ++j) oss << " " << P[i][j];
+      return oss.str();
+    }
+
+    void FromStream(std::istream& in) {
+      in >> num_samples >> residual_var >> max_residual;
+      for (int i = 0; i < kDim; ++i) in >> w[i];
+      for (int i = 0; i < kDim; ++i)
+        for (int j = 0; j < kDim; ++j) in >> P[i][j];
+    }
+
+    double lambda;
+    Features w;
+    double P[kDim][kDim];
+    double residual_var = 0.0;
+    double max_residual = 0.0;
+    long num_samples = 0;
+  };
+
+  double z_;
+  Curve<kPrefillDim> prefill_;
+  Curve<kDecodeDim> decode_;
+};
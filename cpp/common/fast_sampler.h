@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Token sampling over host logits, without a full softmax when it is not
+// needed.
+//
+// - Greedy (temperature 0 or top_k 1) is an argmax: one vectorized pass to
+//   find the maximum and one to find its first index. No exp, no softmax.
+// - Otherwise one pass computes exp((logit - max) / temperature) and its
+//   sum. Top-k / top-p then need the largest probabilities but not their
+//   order: a histogram of (max - logit) / temperature in kBucketsPerUnit
+//   buckets finds the bucket where the top-k count or the top-p mass is
+//   crossed. Only that bucket is sorted, and the token is drawn from the
+//   nucleus in index order. No full sort of the vocabulary.
+//
+// The passes use AVX-512 or AVX2 when the translation unit is compiled for
+// it (-mavx2 -mfma, -mavx512f or -march=native) and plain loops otherwise.
+// SampleReference() is the straightforward softmax + sort sampler, kept as
+// the baseline and for checking results. Logits may be -inf (masked): they
+// get probability 0 on every path and are never drawn, unless every logit
+// is masked: then nothing can be drawn and both samplers return 0, the
+// index Argmax() gives. top_p <= 0 keeps only the most likely token.
+namespace sampling {
+
+struct Params {
+  float temperature = 1.0f;  // <= 0: greedy
+  int top_k = 0;             // <= 0: off
+  float top_p = 1.0f;        // >= 1: off
+};
+
+inline bool IsGreedy(const Params& params) { return params.temperature <= 0.0f || params.top_k == 1; }
+
+namespace detail {
+
+#if defined(__AVX512F__)
+// GCC passes _mm512_undefined_*() through the unmasked forms of some AVX-512
+// intrinsics, which -Wall reports as maybe-uninitialized; these use the
+// masked forms with every lane set instead. The reductions go through memory
+// for the same reason (_mm512_reduce_*_ps).
+constexpr __mmask16 kAllLanes = 0xFFFF;
+
+inline __m512 Max512(__m512 a, __m512 b) { return _mm512_mask_max_ps(a, kAllLanes, a, b); }
+
+inline float ReduceMax512(__m512 v) {
+  alignas(64) float lanes[16];
+  _mm512_store_ps(lanes, v);
+  return *std::max_element(lanes, lanes + 16);
+}
+
+inline double ReduceSum512(__m512 v) {
+  alignas(64) float lanes[16];
+  _mm512_store_ps(lanes, v);
+  return std::accumulate(lanes, lanes + 16, 0.0);
+}
+
+inline __m512 Exp512(__m512 x) {
+  // Cephes expf; x <= 0 here. Below -87 (and for NaN) the result is 0, so a
+  // masked (-inf) logit gets no probability.
+  __mmask16 live = _mm512_cmp_ps_mask(x, _mm512_set1_ps(-87.0f), _CMP_GE_OQ);
+  x = Max512(x, _mm512_set1_ps(-87.0f));
+  __m512 t = _mm512_fmadd_ps(x, _mm512_set1_ps(1.44269504f), _mm512_set1_ps(0.5f));
+  __m512 n = _mm512_mask_roundscale_ps(t, kAllLanes, t, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  x = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+  x = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), x);
+  __m512 y = _mm512_set1_ps(1.9875691500e-4f);
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.3981999507e-3f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(8.3334519073e-3f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(4.1665795894e-2f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.6666665459e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(5.0000001201e-1f));
+  y = _mm512_fmadd_ps(y, _mm512_mul_ps(x, x), _mm512_add_ps(x, _mm512_set1_ps(1.0f)));
+  __m512i zero = _mm512_setzero_si512();
+  __m512i e = _mm512_add_epi32(_mm512_mask_cvtps_epi32(zero, kAllLanes, n), _mm512_set1_epi32(127));
+  e = _mm512_mask_slli_epi32(zero, kAllLanes, e, 23);
+  return _mm512_maskz_mul_ps(live, y, _mm512_castsi512_ps(e));
+}
+#elif defined(__AVX2__)
+inline __m256 Exp256(__m256 x) {
+  // Cephes expf; x <= 0 here. Below -87 (and for NaN) the result is 0, so a
+  // masked (-inf) logit gets no probability.
+  __m256 live = _mm256_cmp_ps(x, _mm256_set1_ps(-87.0f), _CMP_GE_OQ);
+  x = _mm256_max_ps(x, _mm256_set1_ps(-87.0f));
+  __m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(1.44269504f), _mm256_set1_ps(0.5f)));
+  x = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+  x = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), x);
+  __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507e-3f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073e-3f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894e-2f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201e-1f));
+  y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x), _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+  __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  return _mm256_and_ps(live, _mm256_mul_ps(y, _mm256_castsi256_ps(e)));
+}
+
+inline float HorizontalMax(__m256 v) {
+  __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+  m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+  return _mm_cvtss_f32(m);
+}
+
+inline float HorizontalSum(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+#endif
+
+}  // namespace detail
+
+inline const char* SimdName() {
+#if defined(__AVX512F__)
+  return "avx512";
+#elif defined(__AVX2__)
+  return "avx2";
+#else
+  return "scalar";
+#endif
+}
+
+inline float Max(const float* x, int n) {
+  int i = 0;
+  float m = -INFINITY;
+#if defined(__AVX512F__)
+  __m512 v = _mm512_set1_ps(-INFINITY);
+  for (; i + 16 <= n; i += 16) v = detail::Max512(v, _mm512_loadu_ps(x + i));
+  m = detail::ReduceMax512(v);
+#elif defined(__AVX2__)
+  __m256 v = _mm256_set1_ps(-INFINITY);
+  for (; i + 8 <= n; i += 8) v = _mm256_max_ps(v, _mm256_loadu_ps(x + i));
+  m = detail::HorizontalMax(v);
+#endif
+  for (; i < n; ++i) m = std::max(m, x[i]);
+  return m;
+}
+
+// First index of the maximum.
+inline int Argmax(const float* x, int n) {
+  if (n <= 0) return -1;
+  float m = Max(x, n);
+  int i = 0;
+#if defined(__AVX512F__)
+  __m512 vm = _mm512_set1_ps(m);
+  for (; i + 16 <= n; i += 16) {
+    __mmask16 eq = _mm512_cmp_ps_mask(_mm512_loadu_ps(x + i), vm, _CMP_EQ_OQ);
+    if (eq != 0) return i + __builtin_ctz(eq);
+  }
+#elif defined(__AVX2__)
+  __m256 vm = _mm256_set1_ps(m);
+  for (; i + 8 <= n; i += 8) {
+    int eq = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x + i), vm, _CMP_EQ_OQ));
+    if (eq != 0) return i + __builtin_ctz(eq);
+  }
+#endif
+  for (; i < n; ++i) {
+    if (x[i] == m) return i;
+  }
+  return 0;  // NaN logits
+}
+
+// out[i] = exp((x[i] - max) * inv_temperature), 0 where that is below -87
+// (e^-87 is the smallest normal float) or NaN; returns the sum.
+inline double ExpShifted(const float* x, int n, float max, float inv_temperature, float* out) {
+  int i = 0;
+  double sum = 0.0;
+#if defined(__AVX512F__)
+  __m512 vmax = _mm512_set1_ps(max), vinv = _mm512_set1_ps(inv_temperature), vsum = _mm512_setzero_ps();
+  for (; i + 16 <= n; i += 16) {
+    __m512 e = detail::Exp512(_mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(x + i), vmax), vinv));
+    _mm512_storeu_ps(out + i, e);
+    vsum = _mm512_add_ps(vsum, e);
+  }
+  sum = detail::ReduceSum512(vsum);
+#elif defined(__AVX2__)
+  __m256 vmax = _mm256_set1_ps(max), vinv = _mm256_set1_ps(inv_temperature), vsum = _mm256_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    __m256 e = detail::Exp256(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), vmax), vinv));
+    _mm256_storeu_ps(out + i, e);
+    vsum = _mm256_add_ps(vsum, e);
+  }
+  sum = detail::HorizontalSum(vsum);
+#endif
+  for (; i < n; ++i) {
+    float d = (x[i] - max) * inv_temperature;
+    out[i] = d >= -87.0f ? std::exp(d) : 0.0f;
+    sum += out[i];
+  }
+  return sum;
+}
+
+// Keeps its scratch buffers between steps; one per sampling thread.
+class Sampler {
+public:
+  // Buckets per unit of (max - logit) / temperature; the last bucket holds
+  // everything below kBuckets / kBucketsPerUnit (probability ratio e^-32).
+  static constexpr int kBuckets = 256;
+  static constexpr float kBucketsPerUnit = 8.0f;
+
+  // `uniform` in [0, 1).
+  int Sample(const float* logits, int n, const Params& params, float uniform) {
+    if (n <= 0) return -1;
+    if (IsGreedy(params)) return Argmax(logits, n);
+
+    float max = Max(logits, n);
+    if (!(max > -INFINITY)) return 0;  // every token masked
+    float inv_temperature = 1.0f / params.temperature;
+    probs_.resize(n);
+    double sum = ExpShifted(logits, n, max, inv_temperature, probs_.data());
+
+    bool top_k = params.top_k > 0 && params.top_k < n;
+    bool top_p = params.top_p < 1.0f;
+    if (!top_k && !top_p) return Draw(probs_.data(), n, sum * uniform);
+
+    // Histogram of distance from the maximum
+    std::fill(std::begin(mass_), std::end(mass_), 0.0);
+    std::fill(std::begin(count_), std::end(count_), 0);
+    float scale = inv_temperature * kBucketsPerUnit;
+    for (int i = 0; i < n; ++i) {
+      int b = Bucket((max - logits[i]) * scale);
+      mass_[b] += probs_[i];
+      count_[b]++;
+    }
+
+    // Boundary bucket: the first whose inclusion reaches the top-k count or
+    // the top-p mass
+    double target_mass = top_p ? params.top_p * sum : sum;
+    int target_count = top_k ? params.top_k : n;
+    double mass_before = 0.0;
+    int count_before = 0;
+    int boundary = 0;
+    for (; boundary < kBuckets - 1; ++boundary) {
+      if (mass_before + mass_[boundary] >= target_mass || count_before + count_[boundary] >= target_count) break;
+      mass_before += mass_[boundary];
+      count_before += count_[boundary];
+    }
+
+    // Tokens above the boundary bucket are all kept; those in it are kept
+    // from the largest down until the count or mass is reached. The nucleus
+    // keeps at least one token: with top_p <= 0 the target mass is reached
+    // before any is kept, and the boundary is then bucket 0, holding the max.
+    nucleus_.clear();
+    edge_.clear();
+    for (int i = 0; i < n; ++i) {
+      int b = Bucket((max - logits[i]) * scale);
+      if (b < boundary) nucleus_.push_back(i);
+      else if (b == boundary) edge_.push_back(i);
+    }
+    std::sort(edge_.begin(), edge_.end(), [this](int a, int b) {
+      return probs_[a] != probs_[b] ? probs_[a] > probs_[b] : a < b;
+    });
+    double kept_mass = mass_before;
+    int kept_count = count_before;
+    for (int i : edge_) {
+      if (!nucleus_.empty() && (kept_mass >= target_mass || kept_count >= target_count)) break;
+      nucleus_.push_back(i);
+      kept_mass += probs_[i];
+      kept_count++;
+    }
+
+    double r = kept_mass * uniform;
+    int last = nucleus_.front();
+    for (int i : nucleus_) {
+      if (probs_[i] <= 0.0f) continue;
+      r -= probs_[i];
+      if (r < 0.0) return i;
+      last = i;
+    }
+    return last;
+  }
+
+  // Size of the last top-k / top-p nucleus (for checks).
+  size_t nucleus_size() const { return nucleus_.size(); }
+
+private:
+  // Clamped in float before the conversion: a -inf or NaN logit, or a gap
+  // too large for an int, lands in the last bucket.
+  static int Bucket(float distance) {
+    if (!(distance < static_cast<float>(kBuckets - 1))) return kBuckets - 1;
+    return distance > 0.0f ? static_cast<int>(distance) : 0;
+  }
+
+  // When rounding leaves r >= 0, the last token with any probability.
+  static int Draw(const float* probs, int n, double r) {
+    int last = 0;
+    for (int i = 0; i < n; ++i) {
+      if (probs[i] <= 0.0f) continue;
+      r -= probs[i];
+      if (r < 0.0) return i;
+      last = i;
+    }
+    return last;
+  }
+
+  std::vector<float> probs_;
+  std::vector<int> nucleus_;
+  std::vector<int> edge_;
+  double mass_[kBuckets];
+  int count_[kBuckets];
+};
+
+// Baseline: full softmax, then the argmax (greedy), a draw in index order
+// (no top-k / top-p) or a cut of the tokens by probability and a draw. The
+// cut sorts only the prefix it needs: the top-k tokens, and for top-p a
+// prefix that doubles until it holds the mass.
+inline int SampleReference(const float* logits, int n, const Params& params, float uniform,
+                           std::vector<int>* nucleus = nullptr) {
+  if (n <= 0) return -1;
+  float temperature = IsGreedy(params) ? 1.0f : params.temperature;
+  float max = *std::max_element(logits, logits + n);
+  if (!(max > -INFINITY)) {  // every token masked
+    if (nucleus != nullptr) nucleus->clear();
+    return 0;
+  }
+  std::vector<float> probs(n);
+  double sum = 0.0;
+  for (int i = 0; i < n; ++i) {
+    float d = (logits[i] - max) / temperature;
+    probs[i] = d >= -87.0f ? std::exp(d) : 0.0f;  // same cutoff as ExpShifted
+    sum += probs[i];
+  }
+  for (int i = 0; i < n; ++i) probs[i] = static_cast<float>(probs[i] / sum);
+  if (IsGreedy(params)) return static_cast<int>(std::max_element(probs.begin(), probs.end()) - probs.begin());
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  auto by_prob = [&](int a, int b) { return probs[a] != probs[b] ? probs[a] > probs[b] : a < b; };
+
+  int keep = n;
+  if (params.top_k > 0) keep = std::min(keep, params.top_k);
+  if (params.top_k > 0 || params.top_p < 1.0f) {
+    int sorted = params.top_p < 1.0f ? std::min(keep, 64) : keep;
+    std::partial_sort(order.begin(), order.begin() + sorted, order.end(), by_prob);
+    if (params.top_p < 1.0f) {
+      double cum = 0.0;
+      for (int i = 0; i < keep; ++i) {
+        if (i == sorted) {
+          int next = std::min(keep, sorted * 2);
+          std::partial_sort(order.begin() + sorted, order.begin() + next, order.end(), by_prob);
+          sorted = next;
+        }
+        cum += probs[order[i]];
+        if (cum >= params.top_p) {
+          keep = i + 1;
+          break;
+        }
+      }
+    }
+  }
+  if (nucleus != nullptr) nucleus->assign(order.begin(), order.begin() + keep);
+  double kept = 0.0;
+  for (int i = 0; i < keep; ++i) kept += probs[order[i]];
+  double r = kept * uniform;
+  int last = order[0];
+  for (int i = 0; i < keep; ++i) {
+    if (probs[order[i]] <= 0.0f) continue;
+    r -= probs[order[i]];
+    if (r < 0.0) return order[i];
+    last = order[i];
+  }
+  return last;
+}
+
+}  // namespace sampling
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// HDR-style latency histogram at nanosecond resolution.
+//
+// Values below 2^kSubBits ns are counted exactly; above that every power of
+// two is split into 2^(kSubBits-1) linear buckets, so a reported value is
+// within 0.2% of the recorded one (rounded up). Values up to 2^40 ns
+// (~18 minutes) are tracked; larger ones land in the last bucket. Raw
+// samples are kept as well for the extreme-value WCET estimate.
+class LatencyHistogram {
+public:
+  static constexpr int kSubBits = 10;
+  static constexpr int kMaxBits = 40;
+
+  LatencyHistogram() : counts_(NumBuckets(), 0) {}
+
+  void Record(int64_t ns) {
+    ns = std::max<int64_t>(ns, 0);
+    counts_[Index(ns)]++;
+    count_++;
+    sum_ += static_cast<double>(ns);
+    sum_sq_ += static_cast<double>(ns) * ns;
+    min_ = count_ == 1 ? ns : std::min(min_, ns);
+    max_ = std::max(max_, ns);
+    samples_.push_back(ns);
+  }
+
+  template <typename Rep, typename Period>
+  void Record(std::chrono::duration<Rep, Period> d) {
+    Record(static_cast<int64_t>(std::chrono::duration<double, std::nano>(d).count()));
+  }
+
+  void Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+    if (other.count_ > 0) min_ = count_ == 0 ? other.min_ : std::min(min_, other.min_);
+    count_ += other.count_;
+    sum_ += other.sum_;
+    sum_sq_ += other.sum_sq_;
+    max_ = std::max(max_, other.max_);
+    samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+  }
+
+  void Clear() { *this = LatencyHistogram(); }
+
+  uint64_t count() const { return count_; }
+  int64_t min() const { return min_; }
+  int64_t max() const { return max_; }
+  double mean() const { return count_ > 0 ? sum_ / count_ : 0.0; }
+  double stddev() const {
+    if (count_ < 2) return 0.0;
+    double m = mean();
+    return std::sqrt(std::max(0.0, sum_sq_ / count_ - m * m));
+  }
+  const std::vector<int64_t>& samples() const { return samples_; }
+
+  // Smallest recorded value v such that `p` percent of the samples are <= v
+  // (upper edge of its bucket, capped at max()).
+  int64_t Percentile(double p) const {
+    if (count_ == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * count_));
+    rank = std::clamp<uint64_t>(rank, 1, count_);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+      seen += counts_[i];
+      if (seen >= rank) return i + 1 == counts_.size() ? max_ : std::min(HighestEquivalent(i), max_);
+    }
+    return max_;
+  }
+
+  // Probabilistic WCET from block maxima fitted with a Gumbel distribution
+  // (method of moments): the value a block of `block_size` samples exceeds
+  // with probability `exceedance`. Falls back to max() with fewer than
+  // eight blocks.
+  double GumbelWcet(size_t block_size = 20, double exceedance = 1e-9) const {
+    size_t blocks = block_size > 0 ? samples_.size() / block_size : 0;
+    if (blocks < 8) return static_cast<double>(max_);
+    std::vector<double> maxima(blocks);
+    for (size_t b = 0; b < blocks; ++b) {
+      maxima[b] = static_cast<double>(
+          *std::max_element(samples_.begin() + b * block_size, samples_.begin() + (b + 1) * block_size));
+    }
+    double mean = 0.0;
+    for (double m : maxima) mean += m;
+    mean /= blocks;
+    double var = 0.0;
+    for (double m : maxima) var += (m - mean) * (m - mean);
+    var /= blocks - 1;
+    const double kPi = 3.14159265358979323846;
+    const double kEulerGamma = 0.57721566490153286;
+    double beta = std::sqrt(6.0 * var) / kPi;
+    double mu = mean - kEulerGamma * beta;
+    double wcet = mu - beta * std::log(-std::log1p(-exceedance));
+    return std::max(wcet, static_cast<double>(max_));
+  }
+
+private:
+  static size_t NumBuckets() { return (size_t{1} << kSubBits) + (kMaxBits - kSubBits + 1) * (size_t{1} << (kSubBits - 1)); }
+
+  static int Msb(uint64_t v) { return 63 - __builtin_clzll(v); }
+
+  static size_t Index(int64_t ns) {
+    uint64_t v = static_cast<uint64_t>(ns);
+    if (v < (uint64_t{1} << kSubBits)) return static_cast<size_t>(v);
+    int shift = std::min(Msb(v), kMaxBits) - (kSubBits - 1);
+    uint64_t half = uint64_t{1} << (kSubBits - 1);
+    uint64_t sub = std::min(v >> shift, (uint64_t{1} << kSubBits) - 1);
+    return static_cast<size_t>((uint64_t{1} << kSubBits) + (shift - 1) * half + (sub - half));
+  }
+
+  static int64_t HighestEquivalent(size_t index) {
+    if (index < (size_t{1} << kSubBits)) return static_cast<int64_t>(index);
+    size_t half = size_t{1} << (kSubBits - 1);
+    size_t k = index - (size_t{1} << kSubBits);
+    int shift = static_cast<int>(k / half) + 1;
+    uint64_t sub = k % half + half;
+    return static_cast<int64_t>(((sub + 1) << shift) - 1);
+  }
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0;
+  double sum_ = 0.0;
+  double sum_sq_ = 0.0;
+  int64_t min_ = 0;
+  int64_t max_ = 0;
+  std::vector<int64_t> samples_;
+};
+
+// Named latency histograms (one per segment type) for a benchmark loop.
+// Samples recorded during the first `warmup` iterations are dropped.
+class LatencyRecorder {
+public:
+  explicit LatencyRecorder(int warmup = 0) : warmup_(warmup) {}
+
+  void StartIteration(int iteration) { iteration_ = iteration; }
+  bool warming_up() const { return iteration_ < warmup_; }
+
+  template <typename Rep, typename Period>
+  void Record(const std::string& type, std::chrono::duration<Rep, Period> d) {
+    if (warming_up()) return;
+    Get(type).Record(d);
+  }
+
+  LatencyHistogram& Get(const std::string& type) {
+    auto it = histograms_.find(type);
+    if (it == histograms_.end()) {
+      order_.push_back(type);
+      it = histograms_.emplace(type, LatencyHistogram()).first;
+    }
+    return it->second;
+  }
+
+  // "# <type> time" blocks in recording order, in milliseconds.
+  void Print(std::ostream& out) {
+    for (const std::string& type : order_) PrintHistogram(out, type + " time", histograms_[type]);
+  }
+
+  static void PrintHistogram(std::ostream& out, const std::string& title, const LatencyHistogram& h) {
+    auto ms = [](double ns) { return ns / 1e6; };
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "===========================" << std::endl;
+    out << "# " << title << " (" << h.count() << " samples)" << std::endl;
+    out << "Average response time: " << ms(h.mean()) << "ms" << std::endl;
+    out << "Worst response time: " << ms(static_cast<double>(h.max())) << "ms" << std::endl;
+    out << "p50: " << ms(static_cast<double>(h.Percentile(50.0))) << "ms" << std::endl;
+    out << "p99: " << ms(static_cast<double>(h.Percentile(99.0))) << "ms" << std::endl;
+    out << "p99.9: " << ms(static_cast<double>(h.Percentile(99.9))) << "ms" << std::endl;
+    out << "pWCET(1e-9): " << ms(h.GumbelWcet()) << "ms" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+private:
+  int warmup_;
+  int iteration_ = 0;
+  std::map<std::string, LatencyHistogram> histograms_;
+  std::vector<std::string> order_;
+};
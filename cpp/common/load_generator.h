@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "latency_histogram.h"
+
+// Open-loop load generation against an LLM serving backend.
+//
+// Arrivals follow a precomputed schedule (Poisson at a target rate, or the
+// timestamps of a request trace) and are never held back by the backend: a
+// request that arrives while every worker is busy waits in the queue, and
+// the wait counts towards its latency. TTFT and end-to-end latency are
+// measured from the scheduled arrival, so a saturated backend cannot hide
+// its backlog by slowing the generator down (no coordinated omission).
+struct LoadRequest {
+  std::string prompt;
+  int max_tokens = 256;
+  double arrival_s = -1.0;  // trace timestamp; < 0: not trace-timed
+};
+
+struct LoadSlo {
+  double ttft_ms = 1000.0;
+  double tpot_ms = 100.0;
+};
+
+struct LoadReport {
+  std::string backend;          // what served the requests, as given to LoadGenerator
+  double offered_qps = 0.0;     // 0: trace-timed
+  size_t num_requests = 0;
+  size_t num_slo_met = 0;
+  uint64_t num_tokens = 0;
+  double duration_s = 0.0;      // first arrival to last completion
+  double throughput_qps = 0.0;
+  double goodput_qps = 0.0;     // completed requests that met both SLOs, per second
+  double token_throughput = 0.0;
+  LatencyHistogram queue;       // arrival to start of service
+  LatencyHistogram ttft;        // arrival to first token
+  LatencyHistogram tpot;        // mean inter-token time after the first token
+  LatencyHistogram e2e;         // arrival to last token
+
+  double slo_attainment() const { return num_requests > 0 ? static_cast<double>(num_slo_met) / num_requests : 0.0; }
+};
+
+// Arrival offsets in seconds of `n` requests from a Poisson process.
+inline std::vector<double> PoissonArrivals(size_t n, double qps, uint32_t seed = 4542) {
+  std::mt19937 rng(seed);
+  std::exponential_distribution<double> gap(qps);
+  std::vector<double> arrivals(n);
+  double t = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    arrivals[i] = t;
+    t += gap(rng);
+  }
+  return arrivals;
+}
+
+// Arrival offsets from the trace timestamps, relative to the first one and
+// compressed by `speedup`.
+inline std::vector<double> TraceArrivals(const std::vector<LoadRequest>& requests, double speedup = 1.0) {
+  std::vector<double> arrivals(requests.size(), 0.0);
+  if (requests.empty()) return arrivals;
+  double first = requests.front().arrival_s;
+  for (const LoadRequest& request : requests) first = std::min(first, request.arrival_s);
+  for (size_t i = 0; i < requests.size(); ++i) arrivals[i] = (requests[i].arrival_s - first) / speedup;
+  return arrivals;
+}
+
+class LoadGenerator {
+public:
+  using Clock = std::chrono::steady_clock;
+  // Called by the backend for every `num_tokens` tokens it produced, at
+  // `produced` (Clock::now() for a backend that reports tokens as they come;
+  // a backend that collects them may report them afterwards with their
+  // recorded times).
+  using TokenCallback = std::function<void(int num_tokens, Clock::time_point produced)>;
+  // Serves one request to completion on worker `worker` (0..num_workers-1).
+  using ServeFunc = std::function<void(int worker, const LoadRequest& request, const TokenCallback& on_tokens)>;
+
+  // `backend` names what `serve` runs on and is copied into every report.
+  LoadGenerator(ServeFunc serve, int num_workers, std::string backend)
+      : serve_(std::move(serve)), num_workers_(std::max(1, num_workers)), backend_(std::move(backend)) {}
+
+  LoadReport Run(const std::vector<LoadRequest>& requests, const std::vector<double>& arrivals_s,
+                 const LoadSlo& slo) {
+    size_t n = std::min(requests.size(), arrivals_s.size());
+    std::vector<Metrics> metrics(n);
+    std::deque<size_t> queue;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool dispatched = false;
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < num_workers_; ++w) {
+      workers.emplace_back([&, w] {
+        while (true) {
+          size_t index;
+          {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&] { return dispatched || !queue.empty(); });
+            if (queue.empty()) return;
+            index = queue.front();
+            queue.pop_front();
+          }
+          Metrics& m = metrics[index];
+          m.start = Clock::now();
+          serve_(w, requests[index], [&m](int num_tokens, Clock::time_point produced) {
+            if (num_tokens <= 0) return;
+            if (m.tokens == 0) m.first_token = produced;
+            m.tokens += num_tokens;
+          });
+          m.finish = Clock::now();
+          if (m.tokens == 0) m.first_token = m.finish;
+        }
+      });
+    }
+
+    // Dispatch on schedule, independent of how far the workers are behind.
+    Clock::time_point t0 = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+      auto arrival = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(arrivals_s[i]));
+      std::this_thread::sleep_until(arrival);
+      metrics[i].arrival = arrival;
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue.push_back(i);
+      }
+      cv.notify_one();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      dispatched = true;
+    }
+    cv.notify_all();
+    for (auto& worker : workers) worker.join();
+
+    LoadReport report;
+    report.backend = backend_;
+    report.num_requests = n;
+    Clock::time_point last = t0;
+    for (const Metrics& m : metrics) {
+      report.queue.Record(m.start - m.arrival);
+      report.ttft.Record(m.first_token - m.arrival);
+      report.e2e.Record(m.finish - m.arrival);
+      bool met = std::chrono::duration<double, std::milli>(m.first_token - m.arrival).count() <= slo.ttft_ms;
+      if (m.tokens > 1) {
+        auto tpot = (m.finish - m.first_token) / (m.tokens - 1);
+        report.tpot.Record(tpot);
+        met = met && std::chrono::duration<double, std::milli>(tpot).count() <= slo.tpot_ms;
+      }
+      report.num_slo_met += met;
+      report.num_tokens += m.tokens;
+      last = std::max(last, m.finish);
+    }
+    report.duration_s = std::chrono::duration<double>(last - t0).count();
+    if (report.duration_s > 0.0) {
+      report.throughput_qps = n / report.duration_s;
+      report.goodput_qps = report.num_slo_met / report.duration_s;
+      report.token_throughput = report.num_tokens / report.duration_s;
+    }
+    return report;
+  }
+
+private:
+  struct Metrics {
+    Clock::time_point arrival;
+    Clock::time_point start;
+    Clock::time_point first_token;
+    Clock::time_point finish;
+    int tokens = 0;
+  };
+
+  ServeFunc serve_;
+  int num_workers_;
+  std::string backend_;
+};
+
+// Saturation knee of a QPS sweep: the highest offered rate whose SLO
+// attainment still reaches `target` (0 if none does). Points are in
+// increasing QPS order.
+inline double FindKnee(const std::vector<LoadReport>& sweep, double target = 0.9) {
+  double knee = 0.0;
+  for (const LoadReport& report : sweep) {
+    if (report.slo_attainment() < target) break;
+    knee = report.offered_qps;
+  }
+  return knee;
+}
+
+inline void PrintLoadReport(std::ostream& out, const LoadReport& report) {
+  std::ios::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << "===========================" << std::endl;
+  out << "# backend: " << report.backend << std::endl;
+  if (report.offered_qps > 0.0) out << "# offered load: " << report.offered_qps << " qps (poisson)" << std::endl;
+  else out << "# offered load: trace-timed" << std::endl;
+  out << "requests: " << report.num_requests << ", tokens: " << report.num_tokens << ", duration: " << report.duration_s
+      << "s" << std::endl;
+  out << "throughput: " << report.throughput_qps << " qps, " << report.token_throughput << " tok/s" << std::endl;
+  out << "goodput: " << report.goodput_qps << " qps (SLO attainment " << report.slo_attainment() * 100.0 << "%)"
+      << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+  LatencyRecorder::PrintHistogram(out, "queue time", report.queue);
+  LatencyRecorder::PrintHistogram(out, "TTFT", report.ttft);
+  LatencyRecorder::PrintHistogram(out, "TPOT", report.tpot);
+  LatencyRecorder::PrintHistogram(out, "end-to-end time", report.e2e);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Model directory and library of a driver.
+//
+// Each driver passes the path it was written against; MLC_MODEL_DIR and
+// MLC_MODEL_LIB override it, and --model-dir / --model-lib on the command
+// line override both. Without a library, <model dir>/llama-3.2-1b-cuda.so is
+// used as before. The flags are removed from argv, so the driver's own
+// positional arguments keep their indices.
+struct ModelPaths {
+  std::string model_dir;
+  std::string model_lib;
+
+  static ModelPaths FromArgs(int& argc, char* argv[], const std::string& default_model_dir) {
+    ModelPaths paths;
+    paths.model_dir = default_model_dir;
+    if (const char* env = std::getenv("MLC_MODEL_DIR")) paths.model_dir = env;
+    if (const char* env = std::getenv("MLC_MODEL_LIB")) paths.model_lib = env;
+
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+      bool dir = std::strcmp(argv[i], "--model-dir") == 0;
+      bool lib = std::strcmp(argv[i], "--model-lib") == 0;
+      if ((dir || lib) && i + 1 < argc) {
+        (dir ? paths.model_dir : paths.model_lib) = argv[++i];
+        continue;
+      }
+      argv[kept++] = argv[i];
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+
+    if (paths.model_lib.empty()) paths.model_lib = paths.model_dir + "/llama-3.2-1b-cuda.so";
+    return paths;
+  }
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "cost_model.h"
+
+// Periodic real-time task model for segment-scheduled LLM jobs, and the
+// offline schedulability test that matches SegmentScheduler.
+//
+// A job is a fixed sequence of non-preemptive segments (Request, Prefill(n)
+// and Execute(n) calls) with a WCET each. SegmentScheduler runs them with
+// EDF at segment boundaries, i.e. limited-preemptive EDF, within fixed
+// priority classes. Class c is schedulable if for every absolute deadline t
+// of its tasks up to the busy-period bound
+//   dbf_c(t) + rbf_hp(t) + B_c(t) <= t
+// where dbf_c(t) is the processor demand of class-c jobs with release and
+// deadline in [0, t], rbf_hp(t) the work of higher classes released in
+// [0, t) (they take the engine at every segment boundary regardless of
+// deadlines), and B_c(t) the longest segment of a lower-class task or of a
+// class-c task whose relative deadline exceeds t (the blocking a job can
+// suffer from an already started segment). With a single class this is the
+// plain limited-preemptive EDF test.
+//
+// A runner holds one live request, so a task that shares its runner with a
+// class-c task blocks that task for its whole job, not one segment: such a
+// task is charged with its full WCET in B_c(t).
+struct RtTaskSpec {
+  std::string name;
+  int64_t period_us = 0;    // 0: one job only
+  int64_t deadline_us = 0;  // relative; 0: best effort, only blocks others
+  std::vector<int64_t> segment_wcet_us;
+  int priority = 0;         // class, as SegmentScheduler's TaskConfig::priority
+  int runner = -1;          // tasks with the same runner >= 0 share one; -1: own runner
+
+  int64_t wcet_us() const { return std::accumulate(segment_wcet_us.begin(), segment_wcet_us.end(), int64_t{0}); }
+  int64_t max_segment_us() const {
+    return segment_wcet_us.empty() ? 0 : *std::max_element(segment_wcet_us.begin(), segment_wcet_us.end());
+  }
+};
+
+// Segment WCETs of one job from a fitted cost model (worst_us of every
+// step). Request runs the first prefill chunk inside it, so its WCET is the
+// measured admission overhead plus that chunk. Decoding is bounded by
+// `max_tokens` steps with the context growing from the prompt length.
+inline std::vector<int64_t> SegmentWcetFromCostModel(const CostModel& model, int64_t request_overhead_us,
+                                                     int prompt_tokens, int chunk_size, int prefill_chunks,
+                                                     int max_tokens, int execute_tokens) {
+  std::vector<int64_t> segments;
+  int num_chunks = std::max(1, (prompt_tokens + chunk_size - 1) / chunk_size);
+  auto chunk_cost = [&](int chunk) { return model.PredictPrefillUs(chunk * chunk_size, chunk_size).worst_us; };
+
+  segments.push_back(request_overhead_us + static_cast<int64_t>(std::ceil(chunk_cost(0))));
+  for (int chunk = 1; chunk < num_chunks; chunk += prefill_chunks) {
+    double cost = 0.0;
+    for (int c = chunk; c < std::min(num_chunks, chunk + prefill_chunks); ++c) cost += chunk_cost(c);
+    segments.push_back(static_cast<int64_t>(std::ceil(cost)));
+  }
+  for (int token = 0; token < max_tokens; token += execute_tokens) {
+    double cost = 0.0;
+    for (int t = token; t < std::min(max_tokens, token + execute_tokens); ++t) {
+      cost += model.PredictDecodeUs(prompt_tokens + t).worst_us;
+    }
+    segments.push_back(static_cast<int64_t>(std::ceil(cost)));
+  }
+  return segments;
+}
+
+struct RtTaskReport {
+  std::string name;
+  int64_t wcet_us = 0;
+  int64_t max_segment_us = 0;
+  double utilization = 0.0;
+};
+
+struct SchedulabilityResult {
+  bool schedulable = false;
+  double utilization = 0.0;
+  int64_t horizon_us = 0;      // last deadline checked
+  int64_t failed_at_us = -1;   // first deadline with dbf + blocking > t
+  int64_t min_slack_us = 0;    // min over checked deadlines of t - dbf - blocking
+  std::string reason;
+  std::vector<RtTaskReport> tasks;
+};
+
+// Processor-demand test for limited-preemptive EDF within priority classes,
+// with synchronous release as the critical instant, run once per class.
+// Test points beyond `max_points` deadlines make the result inconclusive,
+// which is reported as rejected.
+inline SchedulabilityResult AnalyzeEdf(const std::vector<RtTaskSpec>& tasks, size_t max_points = 1000000) {
+  SchedulabilityResult result;
+  std::vector<int> classes;
+  for (const RtTaskSpec& task : tasks) {
+    RtTaskReport report{task.name, task.wcet_us(), task.max_segment_us(), 0.0};
+    if (task.deadline_us > 0) {
+      if (report.wcet_us > task.deadline_us && result.reason.empty()) {
+        result.reason = task.name + ": WCET exceeds the relative deadline";
+        result.failed_at_us = task.deadline_us;
+      }
+      if (task.period_us > 0) report.utilization = static_cast<double>(report.wcet_us) / task.period_us;
+    }
+    result.utilization += report.utilization;
+    result.tasks.push_back(report);
+    classes.push_back(task.priority);
+  }
+  if (!result.reason.empty()) return result;
+  if (result.utilization > 1.0) {
+    result.reason = "utilization exceeds 1";
+    return result;
+  }
+  std::sort(classes.begin(), classes.end(), std::greater<int>());
+  classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+
+  result.min_slack_us = INT64_MAX;
+  for (int level : classes) {
+    // A task sharing its runner with a class task holds it for a whole job.
+    auto shares_runner = [&](const RtTaskSpec& task) {
+      if (task.runner < 0) return false;
+      for (const RtTaskSpec& other : tasks) {
+        if (&other != &task && other.runner == task.runner && other.priority == level && other.deadline_us > 0) {
+          return true;
+        }
+      }
+      return false;
+    };
+    // Blocking from a segment (or, on a shared runner, a job) of a lower
+    // class, or of this class with a relative deadline beyond t.
+    auto blocking = [&](int64_t t) {
+      int64_t b = 0;
+      for (const RtTaskSpec& task : tasks) {
+        bool blocks = task.priority < level ||
+                      (task.priority == level && (task.deadline_us == 0 || task.deadline_us > t));
+        if (blocks) b = std::max(b, shares_runner(task) ? task.wcet_us() : task.max_segment_us());
+      }
+      return b;
+    };
+    auto demand = [&](int64_t t) {
+      int64_t d = 0;
+      for (const RtTaskSpec& task : tasks) {
+        if (task.priority != level || task.deadline_us == 0 || t < task.deadline_us) continue;
+        int64_t jobs = task.period_us > 0 ? (t - task.deadline_us) / task.period_us + 1 : 1;
+        d += jobs * task.wcet_us();
+      }
+      return d;
+    };
+    auto interference = [&](int64_t t) {
+      int64_t r = 0;
+      for (const RtTaskSpec& task : tasks) {
+        if (task.priority <= level) continue;
+        int64_t jobs = task.period_us > 0 ? (t + task.period_us - 1) / task.period_us : 1;
+        r += jobs * task.wcet_us();
+      }
+      return r;
+    };
+
+    // Busy-period bound: beyond it the test cannot fail first, since
+    // dbf_c(t) <= U_c t + lag and rbf_hp(t) <= U_hp t + sum of C_hp.
+    int64_t max_deadline = 0;
+    double utilization = 0.0;
+    double lag = 0.0;  // sum of (T - D) * U over periodic tasks of this class
+    double hp_wcet = 0.0;
+    for (const RtTaskSpec& task : tasks) {
+      if (task.priority < level) continue;
+      double u = task.period_us > 0 ? static_cast<double>(task.wcet_us()) / task.period_us : 0.0;
+      if (task.priority > level) {
+        utilization += u;
+        hp_wcet += task.wcet_us();
+      } else if (task.deadline_us > 0) {
+        utilization += u;
+        max_deadline = std::max(max_deadline, task.deadline_us);
+        if (task.period_us > 0) lag += std::max<int64_t>(0, task.period_us - task.deadline_us) * u;
+      }
+    }
+    if (max_deadline == 0) continue;  // best effort only
+    double bound = static_cast<double>(max_deadline);
+    if (utilization < 1.0) {
+      bound = std::max(bound, (lag + hp_wcet + blocking(0)) / (1.0 - utilization));
+    } else {
+      int64_t hyperperiod = 1;
+      for (const RtTaskSpec& task : tasks) {
+        if (task.priority >= level && task.period_us > 0) hyperperiod = std::lcm(hyperperiod, task.period_us);
+      }
+      bound = std::max(bound, static_cast<double>(hyperperiod + max_deadline));
+    }
+    int64_t horizon = static_cast<int64_t>(bound);
+    result.horizon_us = std::max(result.horizon_us, horizon);
+
+    std::vector<int64_t> points;
+    for (const RtTaskSpec& task : tasks) {
+      if (task.priority != level || task.deadline_us == 0) continue;
+      for (int64_t t = task.deadline_us; t <= horizon; t += task.period_us) {
+        points.push_back(t);
+        if (points.size() > max_points) {
+          result.reason = "too many test points, inconclusive";
+          return result;
+        }
+        if (task.period_us == 0) break;
+      }
+    }
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    for (int64_t t : points) {
+      int64_t slack = t - demand(t) - interference(t) - blocking(t);
+      result.min_slack_us = std::min(result.min_slack_us, slack);
+      if (slack < 0) {
+        result.failed_at_us = t;
+        result.reason = "demand plus interference and blocking exceeds t = " + std::to_string(t) + "us";
+        if (classes.size() > 1) result.reason += " in priority class " + std::to_string(level);
+        return result;
+      }
+    }
+  }
+  if (result.min_slack_us == INT64_MAX) result.min_slack_us = 0;
+  result.schedulable = true;
+  return result;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Opt-in real-time execution profile for engine and driver threads.
+//
+// Per thread: CPU affinity and a SCHED_FIFO priority. Per process: lock all
+// current and future pages (mlockall), keep freed heap memory mapped, and
+// prefault a stack and heap reserve so the hot loop does not take page
+// faults. SCHED_FIFO and mlockall need CAP_SYS_NICE / CAP_IPC_LOCK (or
+// root and a raised RLIMIT_MEMLOCK); failures are reported and the thread
+// keeps running with the default policy.
+struct ThreadRtConfig {
+  int cpu = -1;           // -1: no pinning
+  int fifo_priority = 0;  // 1..99 for SCHED_FIFO, 0: keep SCHED_OTHER
+};
+
+struct RtProfile {
+  bool enabled = false;
+  ThreadRtConfig engine_loop;   // CppInterface _background_loop_thread
+  ThreadRtConfig stream_back;   // CppInterface _background_stream_back_loop_thread
+  ThreadRtConfig caller;        // thread calling init() (SegmentRunner segments run here)
+  bool lock_memory = true;
+  size_t prefault_stack_bytes = 512 * 1024;
+  size_t prefault_heap_bytes = 64 * 1024 * 1024;
+};
+
+namespace rt {
+
+inline bool ApplyToThread(const ThreadRtConfig& config, const std::string& name) {
+  bool ok = true;
+  if (config.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(config.cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+      std::cout << "[WARNING] " << name << ": cannot pin to CPU " << config.cpu << ": " << std::strerror(err) << std::endl;
+      ok = false;
+    }
+  }
+  if (config.fifo_priority > 0) {
+    sched_param param{};
+    param.sched_priority = config.fifo_priority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err != 0) {
+      std::cout << "[WARNING] " << name << ": cannot set SCHED_FIFO " << config.fifo_priority << ": "
+                << std::strerror(err) << std::endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// Touch `bytes` of stack below the caller so later growth does not fault.
+inline void PrefaultStack(size_t bytes) {
+  if (bytes == 0) return;
+  volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+  for (size_t i = 0; i < bytes; i += 4096) stack[i] = 0;
+}
+
+// Grow the heap by `bytes`, touch it and give it back to malloc, which
+// keeps it (no trimming, no mmap for large blocks) for later allocations.
+inline void PrefaultHeap(size_t bytes) {
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+  if (bytes == 0) return;
+  char* heap = static_cast<char*>(std::malloc(bytes));
+  if (heap == nullptr) return;
+  for (size_t i = 0; i < bytes; i += 4096) heap[i] = 0;
+  std::free(heap);
+}
+
+inline bool LockMemory() {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    std::cout << "[WARNING] mlockall failed: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Process-wide part of the profile plus the calling thread. Call before the
+// engine threads are started; they apply their own ThreadRtConfig.
+inline bool ApplyProcess(const RtProfile& profile) {
+  if (!profile.enabled) return true;
+  bool ok = true;
+  if (profile.engine_loop.cpu >= 0 && profile.engine_loop.cpu == profile.stream_back.cpu) {
+    std::cout << "[WARNING] stream-back thread shares CPU " << profile.engine_loop.cpu
+              << " with the engine loop" << std::endl;
+  }
+  if (profile.lock_memory) ok &= LockMemory();
+  PrefaultHeap(profile.prefault_heap_bytes);
+  PrefaultStack(profile.prefault_stack_bytes);
+  ok &= ApplyToThread(profile.caller, "caller");
+  return ok;
+}
+
+}  // namespace rt
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "cost_model.h"
+
+// Online estimate of the next step cost for a cost that drifts with position
+// (decode cost grows with context length, prefill chunk cost with the chunk
+// offset). Tracks the last cost, the average growth per step and the average
+// prediction error, and predicts `last + growth + margin * error`.
+class OnlineCostEstimate {
+public:
+  explicit OnlineCostEstimate(double alpha = 0.2, double margin = 2.0) : alpha_(alpha), margin_(margin) {}
+
+  bool HasSample() const { return num_samples_ > 0; }
+
+  double Predict() const {
+    if (num_samples_ == 0) return 0.0;
+    return last_ + growth_ + margin_ * error_;
+  }
+
+  void Update(double cost) {
+    if (num_samples_ > 0) {
+      double predicted = last_ + growth_;
+      error_ += alpha_ * (std::fabs(cost - predicted) - error_);
+      growth_ += alpha_ * ((cost - last_) - growth_);
+    }
+    last_ = cost;
+    num_samples_++;
+  }
+
+  // Keep the learned growth and error, but restart from a new position.
+  void Restart(double first_cost_hint) { last_ = first_cost_hint; }
+
+  double last() const { return last_; }
+
+private:
+  double alpha_;
+  double margin_;
+  double last_ = 0.0;
+  double growth_ = 0.0;
+  double error_ = 0.0;
+  int64_t num_samples_ = 0;
+};
+
+struct BudgetedSegment {
+  std::string output;     // decoded text (ExecuteFor only)
+  int count = 0;          // tokens decoded or chunks prefilled
+  int64_t used_us = 0;    // measured wall time of the segment
+  int64_t budget_us = 0;
+};
+
+// Time-budgeted segments on top of a SegmentRunner-like `Runner`.
+//
+// Step costs come from an attached CostModel (keyed by KV position and
+// context length, and updated with every measured step) or, without one,
+// from an OnlineCostEstimate per segment type. `prefill_chunk_size` must be
+// the one the runner was initialized with; the runner's Request already
+// prefills chunk 0, so chunk positions count from there.
+//
+// ExecuteFor / PrefillFor run single-step segments back to back while the
+// predicted cost of the next step still fits into the remaining budget. A
+// segment always runs at least one step when no estimate exists yet, and at
+// least `min_steps` steps in any case; with the default of 0 it returns with
+// count == 0 if not even one step fits.
+template <typename Runner>
+class BudgetedSegmentRunner {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  BudgetedSegmentRunner(Runner& runner, int prefill_chunk_size) : runner_(runner), chunk_size_(prefill_chunk_size) {
+    if (chunk_size_ <= 0) throw std::invalid_argument("BudgetedSegmentRunner: prefill_chunk_size must be positive");
+  }
+
+  void AttachCostModel(std::shared_ptr<CostModel> model) { cost_model_ = std::move(model); }
+
+  void Request(const std::string& prompt, int max_tokens) {
+    runner_.Request(prompt, max_tokens);
+    // Costs restart at the beginning of a sequence, growth and error carry over.
+    if (prefill_cost_.HasSample()) prefill_cost_.Restart(first_prefill_us_);
+    if (decode_cost_.HasSample()) decode_cost_.Restart(first_decode_us_);
+    num_chunks_ = 1;  // chunk 0 ran inside Request
+    num_tokens_ = 0;
+  }
+
+  BudgetedSegment ExecuteFor(int64_t budget_us, int min_steps = 0) {
+    BudgetedSegment segment;
+    segment.budget_us = budget_us;
+    Clock::time_point start = Clock::now();
+    while (!runner_.IsEnd()) {
+      int64_t used = Elapsed(start);
+      if (segment.count >= min_steps && DecodeKnown() && used + PredictDecode() > budget_us) break;
+      Clock::time_point s = Clock::now();
+      segment.output += runner_.Execute(1);
+      double cost = static_cast<double>(Elapsed(s));
+      if (num_tokens_ == 0) first_decode_us_ = cost;
+      decode_cost_.Update(cost);
+      if (cost_model_) cost_model_->ObserveDecode(ContextLength(), cost);
+      num_tokens_++;
+      segment.count++;
+    }
+    segment.used_us = Elapsed(start);
+    return segment;
+  }
+
+  BudgetedSegment PrefillFor(int64_t budget_us, int min_steps = 0) {
+    BudgetedSegment segment;
+    segment.budget_us = budget_us;
+    Clock::time_point start = Clock::now();
+    while (!runner_.IsPrefillEnd()) {
+      int64_t used = Elapsed(start);
+      if (segment.count >= min_steps && PrefillKnown() && used + PredictPrefill() > budget_us) break;
+      segment.count += PrefillChunks(1);
+    }
+    segment.used_us = Elapsed(start);
+    return segment;
+  }
+
+  // Per-call prefill size. The engine chunk size is fixed by Init, so a call
+  // covers `chunk_tokens` rounded up to whole engine chunks.
+  void PrefillTokens(int chunk_tokens) {
+    Prefill(std::max(1, (chunk_tokens + chunk_size_ - 1) / chunk_size_));
+  }
+
+  // Largest number of engine chunks whose predicted cost stays within
+  // `latency_target_us`, capped at `max_chunks`. Always at least one.
+  int PlanPrefillChunks(int64_t latency_target_us, int max_chunks) const {
+    if (!PrefillKnown()) return 1;
+    double total = 0.0;
+    int chunks = 0;
+    while (chunks < max_chunks) {
+      double cost = cost_model_
+          ? cost_model_->PredictPrefillUs((num_chunks_ + chunks) * chunk_size_, chunk_size_).bound_us
+          : prefill_cost_.Predict();
+      if (chunks > 0 && total + cost > latency_target_us) break;
+      total += cost;
+      chunks++;
+    }
+    return std::max(1, chunks);
+  }
+
+  // One prefill segment sized from a latency target: large effective chunks
+  // when the target is loose, small ones when a deadline is near.
+  BudgetedSegment PrefillWithin(int64_t latency_target_us, int max_chunks) {
+    BudgetedSegment segment;
+    segment.budget_us = latency_target_us;
+    if (runner_.IsPrefillEnd()) return segment;
+    int chunks = PlanPrefillChunks(latency_target_us, max_chunks);
+    Clock::time_point start = Clock::now();
+    segment.count = PrefillChunks(chunks);
+    segment.used_us = Elapsed(start);
+    return segment;
+  }
+
+  // Count-based segments. Prefill stops at the end of the prompt, so only
+  // chunks that ran are counted.
+  void Prefill(int n) { PrefillChunks(n); }
+  std::string Execute(int n) { num_tokens_ += n; return runner_.Execute(n); }
+  bool IsPrefillEnd() { return runner_.IsPrefillEnd(); }
+  bool IsEnd() { return runner_.IsEnd(); }
+
+  // Chunks prefilled so far, including the one run by Request.
+  int num_chunks() const { return num_chunks_; }
+  int num_tokens() const { return num_tokens_; }
+  Runner& runner() { return runner_; }
+
+private:
+  // Up to `n` chunks, one engine call each, until the prompt is prefilled.
+  // Every chunk is timed and observed like a PrefillFor step. Returns the
+  // number of chunks run.
+  int PrefillChunks(int n) {
+    int count = 0;
+    while (count < n && !runner_.IsPrefillEnd()) {
+      Clock::time_point s = Clock::now();
+      runner_.Prefill(1);
+      double cost = static_cast<double>(Elapsed(s));
+      if (num_chunks_ == 1) first_prefill_us_ = cost;
+      prefill_cost_.Update(cost);
+      if (cost_model_) cost_model_->ObservePrefill(num_chunks_ * chunk_size_, chunk_size_, cost);
+      num_chunks_++;
+      count++;
+    }
+    return count;
+  }
+
+  // The prompt length is not exposed by the runner; after prefill it is
+  // approximated by the prefilled chunks.
+  int ContextLength() const { return num_chunks_ * chunk_size_ + num_tokens_; }
+
+  bool PrefillKnown() const {
+    return cost_model_ ? cost_model_->HasPrefillSamples() : prefill_cost_.HasSample();
+  }
+  bool DecodeKnown() const {
+    return cost_model_ ? cost_model_->HasDecodeSamples() : decode_cost_.HasSample();
+  }
+  double PredictPrefill() const {
+    if (cost_model_) return cost_model_->PredictPrefillUs(num_chunks_ * chunk_size_, chunk_size_).bound_us;
+    return prefill_cost_.Predict();
+  }
+  double PredictDecode() const {
+    if (cost_model_) return cost_model_->PredictDecodeUs(ContextLength()).bound_us;
+    return decode_cost_.Predict();
+  }
+
+  static int64_t Elapsed(Clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - since).count();
+  }
+
+  Runner& runner_;
+  int chunk_size_;
+  std::shared_ptr<CostModel> cost_model_;
+  OnlineCostEstimate prefill_cost_;
+  OnlineCostEstimate decode_cost_;
+  double first_prefill_us_ = 0.0;
+  double first_decode_us_ = 0.0;
+  int num_chunks_ = 0;
+  int num_tokens_ = 0;
+};
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Leveled binary logging for the engine and segment hot paths.
+//
+//   SEGMENT_LOG_DEBUG("kv_cache_get_num_available_pages {} -> {}", seq_id, pages);
+//
+// Levels below SEGMENT_LOG_LEVEL compile to nothing (arguments are not
+// evaluated). An enabled message is not formatted: the call site is
+// registered once and every call copies a timestamp and up to kMaxArgs
+// numeric arguments into the calling thread's ring (single producer, no
+// locks, no allocation). A drain thread writes the rings to a binary file
+// off the hot path; segment_log_decode (cpp/09_segment_log) prints it.
+// While no file is open, calls return after one relaxed load. A full ring
+// drops new records and counts them. The ring of an exited thread is drained
+// and handed to the next new thread, so memory follows the number of live
+// threads, not of threads ever started.
+//
+// Arguments must be integral, floating point or bool; `{}` in the format is
+// replaced by the next argument when decoding.
+#define SEGMENT_LOG_LEVEL_TRACE 0
+#define SEGMENT_LOG_LEVEL_DEBUG 1
+#define SEGMENT_LOG_LEVEL_INFO 2
+#define SEGMENT_LOG_LEVEL_WARNING 3
+#define SEGMENT_LOG_LEVEL_ERROR 4
+#define SEGMENT_LOG_LEVEL_OFF 5
+
+#ifndef SEGMENT_LOG_LEVEL
+#define SEGMENT_LOG_LEVEL SEGMENT_LOG_LEVEL_INFO
+#endif
+
+// Records kept per thread until the drain thread catches up (power of two).
+#ifndef SEGMENT_LOG_RING_SIZE
+#define SEGMENT_LOG_RING_SIZE (1 << 14)
+#endif
+
+namespace seglog {
+
+enum Level : uint8_t { kTrace = 0, kDebug, kInfo, kWarning, kError };
+
+inline const char* LevelName(uint8_t level) {
+  static const char* kNames[] = {"TRACE", "DEBUG", "INFO", "WARNING", "ERROR"};
+  return level <= kError ? kNames[level] : "?";
+}
+
+constexpr int kMaxArgs = 5;
+constexpr uint32_t kUnregistered = UINT32_MAX;
+
+// One log call; 64 bytes, written as is.
+struct Record {
+  int64_t ns;             // steady_clock
+  uint32_t site;
+  uint32_t tid;
+  uint8_t num_args;
+  uint8_t float_mask;     // bit i: args[i] holds a double
+  uint8_t pad[6];
+  int64_t args[kMaxArgs];
+};
+static_assert(sizeof(Record) == 64, "Record layout is part of the file format");
+
+struct Site {
+  const char* format;
+  const char* file;
+  int line;
+  Level level;
+  std::atomic<uint32_t> id{kUnregistered};
+};
+
+inline int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class Ring {
+public:
+  static constexpr uint64_t kMask = SEGMENT_LOG_RING_SIZE - 1;
+  static_assert((SEGMENT_LOG_RING_SIZE & kMask) == 0, "SEGMENT_LOG_RING_SIZE must be a power of two");
+
+  Ring(uint32_t tid, std::string name) : records_(new Record[SEGMENT_LOG_RING_SIZE]), tid_(tid), name_(std::move(name)) {}
+
+  Record* Reserve() {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= SEGMENT_LOG_RING_SIZE) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &records_[head & kMask];
+  }
+
+  void Commit() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Consumer side (drain thread only).
+  template <typename Fn>
+  size_t Drain(Fn&& fn) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    for (uint64_t i = tail; i < head; ++i) fn(records_[i & kMask]);
+    tail_.store(head, std::memory_order_release);
+    return head - tail;
+  }
+
+  uint64_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+  // Owner, name and announced_ change only under the logger's lock.
+  uint32_t tid() const { return tid_; }
+  const std::string& name() const { return name_; }
+  bool announced() const { return announced_; }
+  void set_announced(bool announced) { announced_ = announced; }
+  void Assign(uint32_t tid, std::string name) {
+    tid_ = tid;
+    name_ = std::move(name);
+    announced_ = false;
+  }
+
+private:
+  std::unique_ptr<Record[]> records_;
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+  uint32_t tid_;
+  std::string name_;
+  bool announced_ = false;  // thread entry written for tid_ / name_
+};
+
+// File layout: "SEGLOG02", int64 steady_clock ns at open, int64 system_clock
+// ns at open, then tagged entries
+//   'S' site:    u32 id, u8 level, i32 line, u16 len + file, u16 len + format
+//   'T' thread:  u32 tid, u16 len + name
+//   'R' record:  Record
+//   'D' dropped: u32 tid, u64 count
+// A site or thread entry precedes the first record that refers to it; a
+// renamed thread gets a second thread entry. Thread ids are never reused.
+class Logger {
+public:
+  static Logger& Get() {
+    static Logger logger;
+    return logger;
+  }
+
+  bool Open(const std::string& path, std::chrono::milliseconds drain_interval = std::chrono::milliseconds(10)) {
+    Close();
+    std::lock_guard<std::mutex> lock(mtx_);
+    file_ = std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) return false;
+    std::fwrite("SEGLOG02", 1, 8, file_);
+    Write(NowNs());
+    Write(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count()));
+    written_sites_ = 0;
+    for (auto& ring : rings_) ring->set_announced(false);
+    stop_ = false;
+    drainer_ = std::thread([this, drain_interval] {
+      while (!stop_.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(drain_interval);
+        Drain();
+      }
+    });
+    enabled_.store(true, std::memory_order_release);
+    return true;
+  }
+
+  // Stops logging and writes what is still buffered.
+  void Close() {
+    enabled_.store(false, std::memory_order_release);
+    if (drainer_.joinable()) {
+      stop_.store(true, std::memory_order_release);
+      drainer_.join();
+    }
+    Drain();
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (file_ != nullptr) std::fclose(file_);
+    file_ = nullptr;
+  }
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Runtime threshold on top of SEGMENT_LOG_LEVEL.
+  void SetLevel(Level level) { level_.store(level, std::memory_order_relaxed); }
+  bool Accepts(Level level) const { return enabled() && level >= level_.load(std::memory_order_relaxed); }
+
+  uint32_t Register(Site& site) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint32_t id = site.id.load(std::memory_order_relaxed);
+    if (id != kUnregistered) return id;
+    id = static_cast<uint32_t>(sites_.size());
+    sites_.push_back(&site);
+    site.id.store(id, std::memory_order_release);
+    return id;
+  }
+
+  Ring& ThisThreadRing() {
+    RingLease& lease = ThisThreadLease();
+    if (lease.ring == nullptr) lease.ring = RegisterThread("");
+    return *lease.ring;
+  }
+
+  // Best called before the thread's first log: the ring is then registered
+  // with its name. A later call renames the thread from the next drain on.
+  void SetThreadName(const std::string& name) {
+    RingLease& lease = ThisThreadLease();
+    if (lease.ring == nullptr) {
+      lease.ring = RegisterThread(name);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    lease.ring->Assign(lease.ring->tid(), name);
+  }
+
+  ~Logger() { Close(); }
+
+private:
+  // Hands the thread's ring back when the thread exits.
+  struct RingLease {
+    Ring* ring = nullptr;
+    ~RingLease() {
+      if (ring != nullptr) Logger::Get().ReleaseThread(ring);
+    }
+  };
+
+  Logger() = default;
+
+  static RingLease& ThisThreadLease() {
+    thread_local RingLease lease;
+    return lease;
+  }
+
+  Ring* RegisterThread(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint32_t tid = next_tid_++;
+    std::string thread_name = name.empty() ? "thread " + std::to_string(tid) : name;
+    if (!free_rings_.empty()) {
+      Ring* ring = free_rings_.back();
+      free_rings_.pop_back();
+      ring->Assign(tid, std::move(thread_name));
+      return ring;
+    }
+    rings_.push_back(std::make_unique<Ring>(tid, std::move(thread_name)));
+    return rings_.back().get();
+  }
+
+  // The owner has exited, so every record it wrote is committed. While a
+  // file is open the next drain writes them and frees the ring; otherwise
+  // they are discarded now.
+  void ReleaseThread(Ring* ring) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (file_ != nullptr) {
+      retired_rings_.push_back(ring);
+      return;
+    }
+    ring->Drain([](const Record&) {});
+    ring->TakeDropped();
+    free_rings_.push_back(ring);
+  }
+
+  void Drain() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (file_ == nullptr) return;
+    std::vector<Ring*> retired = std::move(retired_rings_);
+    retired_rings_.clear();
+    for (; written_sites_ < sites_.size(); ++written_sites_) {
+      const Site& site = *sites_[written_sites_];
+      std::fputc('S', file_);
+      Write(static_cast<uint32_t>(written_sites_));
+      Write(static_cast<uint8_t>(site.level));
+      Write(static_cast<int32_t>(site.line));
+      WriteString(site.file);
+      WriteString(site.format);
+    }
+    for (auto& ring : rings_) {
+      if (ring->announced()) continue;
+      std::fputc('T', file_);
+      Write(ring->tid());
+      WriteString(ring->name());
+      ring->set_announced(true);
+    }
+    for (auto& ring : rings_) {
+      ring->Drain([this](const Record& record) {
+        std::fputc('R', file_);
+        std::fwrite(&record, sizeof(Record), 1, file_);
+      });
+      uint64_t dropped = ring->TakeDropped();
+      if (dropped > 0) {
+        std::fputc('D', file_);
+        Write(ring->tid());
+        Write(dropped);
+      }
+    }
+    free_rings_.insert(free_rings_.end(), retired.begin(), retired.end());
+    std::fflush(file_);
+  }
+
+  template <typename T>
+  void Write(T value) {
+    std::fwrite(&value, sizeof(T), 1, file_);
+  }
+
+  void WriteString(const std::string& s) {
+    uint16_t len = static_cast<uint16_t>(std::min<size_t>(s.size(), UINT16_MAX));
+    Write(len);
+    std::fwrite(s.data(), 1, len, file_);
+  }
+
+  std::mutex mtx_;
+  std::FILE* file_ = nullptr;
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint8_t> level_{kTrace};
+  std::atomic<bool> stop_{false};
+  std::thread drainer_;
+  std::vector<Site*> sites_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::vector<Ring*> retired_rings_;  // owner exited, records not yet written
+  std::vector<Ring*> free_rings_;     // empty, for the next new thread
+  uint32_t next_tid_ = 0;
+  size_t written_sites_ = 0;
+};
+
+template <typename T>
+inline void PackArg(Record& record, int index, T value) {
+  static_assert(std::is_arithmetic_v<T>, "segment log arguments must be numeric");
+  if constexpr (std::is_floating_point_v<T>) {
+    double d = static_cast<double>(value);
+    std::memcpy(&record.args[index], &d, sizeof(d));
+    record.float_mask |= static_cast<uint8_t>(1u << index);
+  } else {
+    record.args[index] = static_cast<int64_t>(value);
+  }
+}
+
+template <typename... Args>
+inline void Log(Site& site, Args... args) {
+  static_assert(sizeof...(Args) <= kMaxArgs, "too many segment log arguments");
+  Logger& logger = Logger::Get();
+  if (!logger.Accepts(site.level)) return;
+  uint32_t id = site.id.load(std::memory_order_acquire);
+  if (id == kUnregistered) id = logger.Register(site);
+  Ring& ring = logger.ThisThreadRing();
+  Record* record = ring.Reserve();
+  if (record == nullptr) return;
+  record->ns = NowNs();
+  record->site = id;
+  record->tid = ring.tid();
+  record->num_args = sizeof...(Args);
+  record->float_mask = 0;
+  int index = 0;
+  (PackArg(*record, index++, args), ...);
+  ring.Commit();
+}
+
+}  // namespace seglog
+
+// `format` must be a string literal.
+#define SEGMENT_LOG_AT_(level, format, ...)                                          \
+  do {                                                                               \
+    static ::seglog::Site _segment_log_site{format, __FILE__, __LINE__, level};      \
+    ::seglog::Log(_segment_log_site __VA_OPT__(, ) __VA_ARGS__);                     \
+  } while (0)
+
+#if SEGMENT_LOG_LEVEL <= SEGMENT_LOG_LEVEL_TRACE
+#define SEGMENT_LOG_TRACE(format, ...) SEGMENT_LOG_AT_(::seglog::kTrace, format __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define SEGMENT_LOG_TRACE(format, ...) ((void)0)
+#endif
+#if SEGMENT_LOG_LEVEL <= SEGMENT_LOG_LEVEL_DEBUG
+#define SEGMENT_LOG_DEBUG(format, ...) SEGMENT_LOG_AT_(::seglog::kDebug, format __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define SEGMENT_LOG_DEBUG(format, ...) ((void)0)
+#endif
+#if SEGMENT_LOG_LEVEL <= SEGMENT_LOG_LEVEL_INFO
+#define SEGMENT_LOG_INFO(format, ...) SEGMENT_LOG_AT_(::seglog::kInfo, format __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define SEGMENT_LOG_INFO(format, ...) ((void)0)
+#endif
+#if SEGMENT_LOG_LEVEL <= SEGMENT_LOG_LEVEL_WARNING
+#define SEGMENT_LOG_WARNING(format, ...) SEGMENT_LOG_AT_(::seglog::kWarning, format __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define SEGMENT_LOG_WARNING(format, ...) ((void)0)
+#endif
+#if SEGMENT_LOG_LEVEL <= SEGMENT_LOG_LEVEL_ERROR
+#define SEGMENT_LOG_ERROR(format, ...) SEGMENT_LOG_AT_(::seglog::kError, format __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define SEGMENT_LOG_ERROR(format, ...) ((void)0)
+#endif
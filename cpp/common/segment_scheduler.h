@@ -0,0 +1,690 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "segment_budget.h"
+
+// Earliest-deadline-first scheduler over SegmentRunner segments.
+//
+// Every task owns one live request at a time. At each segment boundary the
+// scheduler picks the released job with the earliest absolute deadline and
+// runs exactly one segment of it: the admission (`Request`), one `Prefill(n)`
+// or one `Execute(n)`. Segments are never interrupted, so a job waits at most
+// one segment of another task before it gets the engine. With
+// `segment_budget` set, prefill and decode segments are bounded by time
+// instead of by count (see BudgetedSegmentRunner). With `prefill_chunks`
+// set to 0 the prefill size is chosen per segment: as large as allowed while
+// no other job with a deadline is waiting, and bounded by the slack of the
+// most urgent waiting job otherwise.
+//
+// With a mixed token budget set, a segment instead advances every decoding
+// job by one token and spends the rest of the budget on prefill chunks of the
+// most urgent prefilling job, so admitting a long prompt delays running
+// streams by at most one budget-sized slice per token.
+//
+// With async admission, a released job's Request (template rendering,
+// tokenization, add_request) runs on a worker thread while other jobs'
+// segments run, and the job becomes runnable when it has finished. The
+// admission is recorded as a kRequest segment with the worker's timing.
+//
+// Tasks can be split into priority classes (`priority`, higher first). A
+// released job of a higher class takes the engine at the next segment
+// boundary from any lower one; EDF orders jobs within a class. With a
+// runner per task, priority inversion is therefore bounded by one segment.
+// On a runner shared by best-effort tasks (see below) it is bounded only by
+// the whole job holding the runner. Per-task stats record how often a
+// runnable job of the task was passed over for a higher class (once per
+// episode, until it gets a segment again), how long a job waited from
+// becoming ready to its first segment (the preemption latency), and how
+// long it was blocked by a job that held its shared runner without being
+// ahead of it in class-then-EDF order. AnalyzeEdf in rt_analysis.h tests the
+// same policy and charges a shared runner's whole job as blocking.
+//
+// A runtime monitor checks the deadlines of all released jobs at every
+// segment boundary, so a miss is reported when it happens rather than when
+// the late job completes, and, for tasks with `segment_wcet_us` (see
+// rt_analysis.h), segments that overran their WCET.
+//
+// A live job can be parked with Suspend() and continued with Resume() from
+// any thread. Its runner is left untouched, so the KV cache stays resident
+// and decoding continues without re-prefill; the job just stops receiving
+// segments. Suspension takes effect at the next segment boundary. This is
+// parking only: the KV pages are not offloaded to host memory and no device
+// pages are freed, so a suspended job does not make room for others. That
+// needs a KV offload/restore entry point in the fork's SegmentRunner, which
+// it does not have.
+//
+// SegmentRunner keeps a single live request per instance, so every task
+// with a deadline or a priority class needs a runner of its own: only then
+// is it preempted at every segment boundary. Best-effort tasks (no
+// deadline, class 0) may be added with the same runner to share one engine
+// (one copy of the weights); a job then holds that runner from its
+// admission until it completes (also while suspended) and the other
+// best-effort jobs on it wait. AddTask rejects any other sharing, since a
+// job holding a shared runner would block a deadline task for its whole
+// length. The scheduler serializes all segments on the calling thread.
+//
+// `Runner` must provide Request(prompt, max_tokens), Prefill(n),
+// IsPrefillEnd(), Execute(n) -> std::string and IsEnd().
+template <typename Runner>
+class SegmentScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = std::chrono::microseconds;
+
+  enum class SegmentKind { kRequest, kPrefill, kExecute };
+
+  struct TaskConfig {
+    std::string name;
+    std::string prompt;
+    int max_tokens = 256;
+    Duration relative_deadline{0};  // 0: no deadline (scheduled last)
+    Duration period{0};             // 0: one-shot task
+    Duration offset{0};             // first release relative to Run()
+    int num_jobs = 1;               // releases of a periodic task
+    int prefill_chunks = 1;         // chunks per Prefill segment, 0: adaptive
+    int max_prefill_chunks = 8;     // upper bound of an adaptive Prefill segment
+    int execute_tokens = 1;         // tokens per Execute segment
+    Duration segment_budget{0};     // >0: time-budgeted Prefill/Execute segments
+    std::shared_ptr<CostModel> cost_model;  // optional, shared by tasks on the same model
+    int prefill_chunk_size = 0;     // chunk size the runner was initialized with (required)
+    // Runtime monitor: WCET of the k-th segment of a job (the last entry
+    // covers the rest), e.g. RtTaskSpec::segment_wcet_us. Empty: not checked.
+    std::vector<int64_t> segment_wcet_us;
+    int priority = 0;               // class; higher classes always run first
+  };
+
+  struct JobResult {
+    int task_id;
+    int job_index;
+    Clock::time_point release;
+    Clock::time_point deadline;
+    Clock::time_point finish;
+    std::string output;
+    bool deadline_missed;
+    Duration max_token_gap;  // longest wait between consecutive Execute segments
+  };
+
+  struct SegmentRecord {
+    int task_id;
+    int job_index;
+    SegmentKind kind;
+    Clock::time_point start;
+    Clock::time_point end;
+  };
+
+  enum class ViolationKind { kDeadlineMiss, kSegmentOverrun };
+
+  struct TimingViolation {
+    int task_id;
+    int job_index;
+    ViolationKind kind;
+    int segment_index;    // kSegmentOverrun only
+    int64_t observed_us;  // segment length, or response time
+    int64_t bound_us;     // segment WCET, or relative deadline
+  };
+
+  // Scheduling latencies of Suspend/Resume; no KV transfer is involved.
+  struct SuspendStats {
+    int num_suspends = 0;
+    int64_t max_suspend_latency_us = 0;  // Suspend() until the in-flight segment ended
+    int64_t max_resume_latency_us = 0;   // Resume() until the next segment started
+    int64_t total_suspended_us = 0;
+  };
+
+  struct PriorityStats {
+    int preempted = 0;                   // a runnable job of this task was passed over for a higher class
+    int64_t max_ready_latency_us = 0;    // job ready until its first segment
+    int64_t total_ready_latency_us = 0;
+    int jobs = 0;
+    int engine_blocked = 0;              // waited for a shared runner held by a job not ahead of it
+    int64_t max_engine_blocked_us = 0;   // longest such wait (priority inversion)
+    int64_t total_engine_blocked_us = 0;
+  };
+
+  using CompletionCallback = std::function<void(const JobResult&)>;
+  using ViolationCallback = std::function<void(const TimingViolation&)>;
+
+  // Throws std::invalid_argument if `runner` is already used by another
+  // task and this task or that one has a deadline or a priority class.
+  int AddTask(Runner& runner, TaskConfig config) {
+    for (const Task& other : tasks_) {
+      if (engines_[other.slot] != &runner || (!RealTime(config) && !RealTime(other.config))) continue;
+      throw std::invalid_argument("SegmentScheduler: tasks " + other.config.name + " and " + config.name +
+                                  " share a runner; a task with a deadline or priority needs its own");
+    }
+    Task task;
+    task.runner = std::make_unique<BudgetedSegmentRunner<Runner>>(runner, config.prefill_chunk_size);
+    task.slot = static_cast<int>(std::find(engines_.begin(), engines_.end(), &runner) - engines_.begin());
+    if (task.slot == static_cast<int>(engines_.size())) {
+      engines_.push_back(&runner);
+      engine_owner_.push_back(-1);
+    }
+    if (config.cost_model) task.runner->AttachCostModel(config.cost_model);
+    task.config = std::move(config);
+    tasks_.push_back(std::move(task));
+    std::lock_guard<std::mutex> lock(control_mtx_);
+    controls_.emplace_back();
+    return static_cast<int>(tasks_.size()) - 1;
+  }
+
+  void SetCompletionCallback(CompletionCallback callback) { on_complete_ = std::move(callback); }
+  void SetViolationCallback(ViolationCallback callback) { on_violation_ = std::move(callback); }
+
+  // Tokens per mixed segment: one per decoding job plus `prefill_chunk_size`
+  // per prefill chunk. 0 (default) runs single-job segments.
+  void SetMixedTokenBudget(int tokens) { mixed_token_budget_ = tokens; }
+
+  void SetAsyncAdmission(bool enable) { async_admission_ = enable; }
+
+  // Park the live job of `task_id` at the next segment boundary. Tasks must
+  // all be added before Run() when this is called from another thread.
+  void Suspend(int task_id) {
+    std::lock_guard<std::mutex> lock(control_mtx_);
+    Control& control = controls_[task_id];
+    if (control.suspended) return;
+    control.suspended = true;
+    control.suspend_requested = Clock::now();
+    control.stats.num_suspends++;
+    if (!control.running) control.suspend_effective = control.suspend_requested;
+  }
+
+  void Resume(int task_id) {
+    {
+      std::lock_guard<std::mutex> lock(control_mtx_);
+      Control& control = controls_[task_id];
+      if (!control.suspended) return;
+      control.suspended = false;
+      control.resume_requested = Clock::now();
+      control.resume_pending = true;
+      resume_generation_++;
+      control.stats.total_suspended_us += ElapsedUs(control.suspend_requested, control.resume_requested);
+    }
+    control_cv_.notify_all();
+  }
+
+  bool IsSuspended(int task_id) {
+    std::lock_guard<std::mutex> lock(control_mtx_);
+    return controls_[task_id].suspended;
+  }
+
+  SuspendStats GetSuspendStats(int task_id) {
+    std::lock_guard<std::mutex> lock(control_mtx_);
+    return controls_[task_id].stats;
+  }
+
+  // Run until every task has finished all of its jobs.
+  void Run() {
+    Clock::time_point start = Clock::now();
+    for (Task& task : tasks_) {
+      task.next_release = start + task.config.offset;
+      task.released = false;
+      task.jobs_done = 0;
+      task.blocked_since = Clock::time_point{};
+    }
+    std::fill(engine_owner_.begin(), engine_owner_.end(), -1);
+    while (RunOnce()) {}
+  }
+
+  // Run one segment, or sleep until the next release (or a Resume) if
+  // nothing is ready. Returns false once all tasks are finished.
+  bool RunOnce() {
+    Clock::time_point now = Clock::now();
+    Release(now);
+    CollectAdmissions();
+    CheckDeadlines(now);
+    if (async_admission_) StartAdmissions();
+    TrackEngineBlocking(Clock::now());
+
+    Task* next = PickEarliestDeadline();
+    if (next == nullptr) {
+      Clock::time_point wake = Clock::time_point::max();
+      bool parked = false;
+      Task* admitting = nullptr;
+      for (Task& task : tasks_) {
+        if (task.admitting) {
+          if (admitting == nullptr || task.deadline < admitting->deadline) admitting = &task;
+        } else if (task.released) {
+          parked = true;  // released but suspended
+        } else if (!Finished(task)) {
+          wake = std::min(wake, task.next_release);
+        }
+      }
+      if (admitting != nullptr) {
+        // A Resume meanwhile is picked up once this admission is in.
+        if (wake == Clock::time_point::max()) {
+          admitting->admission.wait();
+        } else {
+          admitting->admission.wait_until(wake);
+        }
+        return true;
+      }
+      if (wake == Clock::time_point::max() && !parked) return false;
+
+      std::unique_lock<std::mutex> lock(control_mtx_);
+      uint64_t generation = resume_generation_;
+      auto resumed = [this, generation] { return resume_generation_ != generation; };
+      if (wake == Clock::time_point::max()) {
+        control_cv_.wait(lock, resumed);
+      } else {
+        control_cv_.wait_until(lock, wake, resumed);
+      }
+      return true;
+    }
+    if (mixed_token_budget_ > 0) {
+      RunMixedSegment();
+    } else {
+      CountPreemptions(RunnableByDeadline(), {next});
+      RunSegment(*next);
+    }
+    return true;
+  }
+
+  const std::vector<JobResult>& results() const { return results_; }
+  const std::vector<SegmentRecord>& segments() const { return segments_; }
+  const std::vector<TimingViolation>& violations() const { return violations_; }
+  const PriorityStats& priority_stats(int task_id) const { return tasks_[task_id].priority_stats; }
+  int num_mixed_segments() const { return num_mixed_segments_; }
+
+private:
+  struct Task {
+    std::unique_ptr<BudgetedSegmentRunner<Runner>> runner;
+    TaskConfig config;
+    Clock::time_point next_release;
+    // current job
+    bool released = false;
+    bool admitted = false;
+    Clock::time_point release;
+    Clock::time_point deadline;
+    std::string output;
+    int segment_index = 0;   // segments of the current job so far
+    Clock::time_point ready; // released (or admitted) and waiting for its first segment
+    bool started = false;
+    PriorityStats priority_stats;
+    bool admitting = false;  // async admission in flight
+    std::future<SegmentRecord> admission;
+    Clock::time_point last_execute;
+    Duration max_token_gap{0};
+    int jobs_done = 0;
+    int slot = 0;                // index into engines_
+    bool passed_over = false;    // skipped for a higher class since its last segment
+    Clock::time_point blocked_since;  // waiting for a shared runner held by a job not ahead of it
+    bool deadline_reported = false;
+  };
+
+  static bool RealTime(const TaskConfig& config) {
+    return config.relative_deadline.count() > 0 || config.priority != 0;
+  }
+
+  bool Finished(const Task& task) const {
+    return !task.released && task.jobs_done >= task.config.num_jobs;
+  }
+
+  void Release(Clock::time_point now) {
+    for (Task& task : tasks_) {
+      if (task.released || task.jobs_done >= task.config.num_jobs || task.next_release > now) continue;
+      task.released = true;
+      task.admitted = false;
+      task.release = task.next_release;
+      task.deadline = task.config.relative_deadline.count() > 0
+                          ? task.release + task.config.relative_deadline
+                          : Clock::time_point::max();
+      task.output.clear();
+      task.segment_index = 0;
+      task.ready = task.release;
+      task.started = false;
+      task.last_execute = Clock::time_point{};
+      task.max_token_gap = Duration{0};
+      task.deadline_reported = false;
+      task.passed_over = false;
+      if (task.config.period.count() > 0) task.next_release += task.config.period;
+    }
+  }
+
+  int TaskId(const Task& task) const { return static_cast<int>(&task - tasks_.data()); }
+
+  // The job of `task` may use its runner: no other live job holds it.
+  bool OwnsEngine(const Task& task) const {
+    int owner = engine_owner_[task.slot];
+    return owner < 0 || owner == TaskId(task);
+  }
+
+  void AcquireEngine(const Task& task) { engine_owner_[task.slot] = TaskId(task); }
+
+  // Starts the admission of every released job whose runner is free, in
+  // priority/deadline order.
+  void StartAdmissions() {
+    std::vector<Task*> waiting;
+    for (Task& task : tasks_) {
+      if (task.released && !task.admitted && !task.admitting && OwnsEngine(task)) waiting.push_back(&task);
+    }
+    std::stable_sort(waiting.begin(), waiting.end(), [](const Task* a, const Task* b) { return Before(*a, *b); });
+    for (Task* task : waiting) {
+      if (!OwnsEngine(*task)) continue;  // taken by an earlier one on the same runner
+      AcquireEngine(*task);
+      StartAdmission(*task);
+    }
+  }
+
+  // Opens and closes the episodes in which a released job waits for its
+  // shared runner while a job that is not ahead of it in class-then-EDF
+  // order holds it.
+  void TrackEngineBlocking(Clock::time_point now) {
+    for (Task& task : tasks_) {
+      int owner = engine_owner_[task.slot];
+      bool blocked = task.released && owner >= 0 && owner != TaskId(task) && !Before(tasks_[owner], task);
+      bool open = task.blocked_since != Clock::time_point{};
+      if (blocked && !open) {
+        task.blocked_since = now;
+        task.priority_stats.engine_blocked++;
+      } else if (!blocked && open) {
+        int64_t blocked_us = ElapsedUs(task.blocked_since, now);
+        task.priority_stats.total_engine_blocked_us += blocked_us;
+        task.priority_stats.max_engine_blocked_us = std::max(task.priority_stats.max_engine_blocked_us, blocked_us);
+        task.blocked_since = Clock::time_point{};
+      }
+    }
+  }
+
+  // Reports each released job whose deadline has passed, once.
+  void CheckDeadlines(Clock::time_point now) {
+    for (Task& task : tasks_) {
+      if (!task.released || task.deadline_reported || now <= task.deadline) continue;
+      task.deadline_reported = true;
+      Violate({TaskId(task), task.jobs_done, ViolationKind::kDeadlineMiss, -1, ElapsedUs(task.release, now),
+               task.config.relative_deadline.count()});
+    }
+  }
+
+  void StartAdmission(Task& task) {
+    task.admitting = true;
+    task.admission = std::async(std::launch::async,
+        [runner = task.runner.get(), config = &task.config,
+         task_id = static_cast<int>(&task - tasks_.data()), job_index = task.jobs_done] {
+          SegmentRecord record{task_id, job_index, SegmentKind::kRequest, Clock::now(), {}};
+          runner->Request(config->prompt, config->max_tokens);
+          record.end = Clock::now();
+          return record;
+        });
+  }
+
+  // Admissions that finished become runnable; their segments are recorded
+  // when collected.
+  void CollectAdmissions() {
+    for (Task& task : tasks_) {
+      if (!task.admitting) continue;
+      if (task.admission.wait_for(Duration{0}) != std::future_status::ready) continue;
+      RecordSegment(task, task.admission.get());
+      task.admitting = false;
+      task.admitted = true;
+      task.ready = Clock::now();
+    }
+  }
+
+  Task* PickEarliestDeadline() {
+    std::lock_guard<std::mutex> lock(control_mtx_);
+    Task* best = nullptr;
+    for (Task& task : tasks_) {
+      if (!task.released || task.admitting || !OwnsEngine(task) || controls_[&task - tasks_.data()].suspended) continue;
+      if (best == nullptr || Before(task, *best)) best = &task;
+    }
+    return best;
+  }
+
+  // Higher priority class first, then earlier deadline.
+  static bool Before(const Task& a, const Task& b) {
+    if (a.config.priority != b.config.priority) return a.config.priority > b.config.priority;
+    return a.deadline < b.deadline;
+  }
+
+  // Runnable jobs in deadline order.
+  std::vector<Task*> RunnableByDeadline() {
+    std::vector<Task*> runnable;
+    {
+      std::lock_guard<std::mutex> lock(control_mtx_);
+      for (Task& task : tasks_) {
+        if (task.released && !task.admitting && OwnsEngine(task) && !controls_[&task - tasks_.data()].suspended) {
+          runnable.push_back(&task);
+        }
+      }
+    }
+    std::stable_sort(runnable.begin(), runnable.end(), [](const Task* a, const Task* b) { return Before(*a, *b); });
+    return runnable;
+  }
+
+  void RunSegment(Task& task) {
+    int task_id = static_cast<int>(&task - tasks_.data());
+    SegmentRecord record{task_id, task.jobs_done, SegmentKind::kRequest, Clock::now(), {}};
+    // Every segment makes progress, even if one step overruns the budget.
+    int64_t budget_us = task.config.segment_budget.count();
+    BeginSegment(task_id, record.start);
+
+    if (!task.admitted) {
+      AcquireEngine(task);
+      task.runner->Request(task.config.prompt, task.config.max_tokens);
+      task.admitted = true;
+    } else if (!task.runner->IsPrefillEnd()) {
+      record.kind = SegmentKind::kPrefill;
+      if (budget_us > 0) {
+        task.runner->PrefillFor(budget_us, 1);
+      } else if (task.config.prefill_chunks <= 0) {
+        task.runner->PrefillWithin(PrefillTarget(task, record.start), task.config.max_prefill_chunks);
+      } else {
+        task.runner->Prefill(task.config.prefill_chunks);
+      }
+    } else {
+      record.kind = SegmentKind::kExecute;
+      if (budget_us > 0) {
+        task.output += task.runner->ExecuteFor(budget_us, 1).output;
+      } else {
+        task.output += task.runner->Execute(task.config.execute_tokens);
+      }
+    }
+    record.end = Clock::now();
+    if (record.kind == SegmentKind::kExecute) TrackTokenGap(task, record.end);
+    RecordSegment(task, record);
+    EndSegment(task_id, record.end);
+
+    if (task.runner->IsPrefillEnd() && task.runner->IsEnd()) Complete(task, record.end);
+  }
+
+  // One decode step of every decoding job, then prefill of the most urgent
+  // prefilling (or not yet admitted) job with the remaining token budget.
+  // Each step is recorded as its own segment.
+  void RunMixedSegment() {
+    std::vector<Task*> runnable = RunnableByDeadline();
+    std::vector<Task*> decoding;
+    Task* prefilling = nullptr;
+    for (Task* task : runnable) {
+      if (task->admitted && task->runner->IsPrefillEnd()) {
+        decoding.push_back(task);
+      } else if (prefilling == nullptr) {
+        prefilling = task;
+      }
+    }
+
+    std::vector<Task*> running = decoding;
+    if (prefilling != nullptr) running.push_back(prefilling);
+    CountPreemptions(runnable, running);
+
+    int remaining = mixed_token_budget_;
+    for (Task* task : decoding) {
+      int task_id = static_cast<int>(task - tasks_.data());
+      SegmentRecord record{task_id, task->jobs_done, SegmentKind::kExecute, Clock::now(), {}};
+      BeginSegment(task_id, record.start);
+      task->output += task->runner->Execute(1);
+      record.end = Clock::now();
+      TrackTokenGap(*task, record.end);
+      RecordSegment(*task, record);
+      EndSegment(task_id, record.end);
+      remaining--;
+    }
+
+    // At least one chunk, so admissions are never starved by decoding jobs.
+    // An admission runs the first prefill chunk inside Request.
+    if (prefilling != nullptr) {
+      int chunk = std::max(1, prefilling->config.prefill_chunk_size);
+      int chunks = std::clamp(remaining / chunk, 1, std::max(1, prefilling->config.max_prefill_chunks));
+      int task_id = static_cast<int>(prefilling - tasks_.data());
+      SegmentRecord record{task_id, prefilling->jobs_done, SegmentKind::kRequest, Clock::now(), {}};
+      BeginSegment(task_id, record.start);
+      if (!prefilling->admitted) {
+        AcquireEngine(*prefilling);
+        prefilling->runner->Request(prefilling->config.prompt, prefilling->config.max_tokens);
+        prefilling->admitted = true;
+      } else {
+        record.kind = SegmentKind::kPrefill;
+        prefilling->runner->Prefill(chunks);
+      }
+      record.end = Clock::now();
+      RecordSegment(*prefilling, record);
+      EndSegment(task_id, record.end);
+    }
+    num_mixed_segments_++;
+
+    Clock::time_point now = Clock::now();
+    for (Task* task : runnable) {
+      if (task->admitted && task->runner->IsPrefillEnd() && task->runner->IsEnd()) Complete(*task, now);
+    }
+  }
+
+  void RecordSegment(Task& task, const SegmentRecord& record) {
+    segments_.push_back(record);
+    const std::vector<int64_t>& wcet = task.config.segment_wcet_us;
+    int index = task.segment_index++;
+    if (wcet.empty()) return;
+    int64_t bound = wcet[std::min<size_t>(index, wcet.size() - 1)];
+    int64_t observed = ElapsedUs(record.start, record.end);
+    if (observed > bound) {
+      Violate({record.task_id, record.job_index, ViolationKind::kSegmentOverrun, index, observed, bound});
+    }
+  }
+
+  void Violate(const TimingViolation& violation) {
+    violations_.push_back(violation);
+    if (on_violation_) on_violation_(violation);
+  }
+
+  void TrackTokenGap(Task& task, Clock::time_point end) {
+    if (task.last_execute != Clock::time_point{}) {
+      task.max_token_gap = std::max(task.max_token_gap, std::chrono::duration_cast<Duration>(end - task.last_execute));
+    }
+    task.last_execute = end;
+  }
+
+  void BeginSegment(int task_id, Clock::time_point start) {
+    Task& task = tasks_[task_id];
+    if (!task.started) {
+      task.started = true;
+      int64_t latency = ElapsedUs(task.ready, start);
+      task.priority_stats.jobs++;
+      task.priority_stats.total_ready_latency_us += latency;
+      task.priority_stats.max_ready_latency_us = std::max(task.priority_stats.max_ready_latency_us, latency);
+    }
+    task.passed_over = false;
+
+    std::lock_guard<std::mutex> lock(control_mtx_);
+    Control& control = controls_[task_id];
+    control.running = true;
+    if (control.resume_pending) {
+      control.resume_pending = false;
+      control.stats.max_resume_latency_us = std::max(
+          control.stats.max_resume_latency_us, ElapsedUs(control.resume_requested, start));
+    }
+  }
+
+  // A runnable job left out of this boundary's `running` jobs while one of a
+  // higher class runs is preempted; counted once until it runs again.
+  void CountPreemptions(const std::vector<Task*>& runnable, const std::vector<Task*>& running) {
+    int top = INT_MIN;
+    for (Task* task : running) top = std::max(top, task->config.priority);
+    for (Task* task : runnable) {
+      if (task->passed_over || task->config.priority >= top) continue;
+      if (std::find(running.begin(), running.end(), task) != running.end()) continue;
+      task->passed_over = true;
+      task->priority_stats.preempted++;
+    }
+  }
+
+  void EndSegment(int task_id, Clock::time_point end) {
+    std::lock_guard<std::mutex> lock(control_mtx_);
+    Control& control = controls_[task_id];
+    control.running = false;
+    if (control.suspended && control.suspend_effective < control.suspend_requested) {
+      control.suspend_effective = end;
+      control.stats.max_suspend_latency_us = std::max(
+          control.stats.max_suspend_latency_us, ElapsedUs(control.suspend_requested, end));
+    }
+  }
+
+  // Latency target of an adaptive prefill segment of `task`: unbounded while
+  // no other job with a deadline is released, otherwise the slack (deadline
+  // minus now) of the most urgent one.
+  int64_t PrefillTarget(const Task& task, Clock::time_point now) const {
+    int64_t target = INT64_MAX;
+    for (const Task& other : tasks_) {
+      if (&other == &task || !other.released || other.deadline == Clock::time_point::max()) continue;
+      int64_t slack = std::chrono::duration_cast<Duration>(other.deadline - now).count();
+      target = std::min(target, std::max<int64_t>(slack, 0));
+    }
+    return target;
+  }
+
+  void Complete(Task& task, Clock::time_point finish) {
+    int task_id = static_cast<int>(&task - tasks_.data());
+    JobResult result{task_id, task.jobs_done, task.release, task.deadline, finish,
+                     std::move(task.output), finish > task.deadline, task.max_token_gap};
+    if (result.deadline_missed && !task.deadline_reported) {
+      Violate({task_id, result.job_index, ViolationKind::kDeadlineMiss, -1, ElapsedUs(task.release, finish),
+               task.config.relative_deadline.count()});
+    }
+    task.released = false;
+    task.jobs_done++;
+    engine_owner_[task.slot] = -1;
+    if (on_complete_) on_complete_(result);
+    results_.push_back(std::move(result));
+  }
+
+  // Suspend/resume state, shared with other threads under `control_mtx_`.
+  struct Control {
+    bool suspended = false;
+    bool running = false;
+    bool resume_pending = false;
+    Clock::time_point suspend_requested;
+    Clock::time_point suspend_effective;
+    Clock::time_point resume_requested;
+    SuspendStats stats;
+  };
+
+  static int64_t ElapsedUs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+  }
+
+  std::vector<Task> tasks_;
+  std::vector<Runner*> engines_;   // distinct runners of the tasks
+  std::vector<int> engine_owner_;  // task whose job holds each runner, -1: free
+  std::vector<Control> controls_;
+  std::mutex control_mtx_;
+  std::condition_variable control_cv_;
+  uint64_t resume_generation_ = 0;
+  std::vector<JobResult> results_;
+  std::vector<SegmentRecord> segments_;
+  std::vector<TimingViolation> violations_;
+  CompletionCallback on_complete_;
+  ViolationCallback on_violation_;
+  int mixed_token_budget_ = 0;
+  bool async_admission_ = false;
+  int num_mixed_segments_ = 0;
+};
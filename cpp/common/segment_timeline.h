@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "trace.h"
+
+#if SEGMENT_TIMELINE_CUDA
+#include <cuda_runtime.h>
+#endif
+
+// Per-segment timeline of engine actions and packed-function calls.
+//
+// The engine wraps each action and each packed-function call in a scope
+//   SEGMENT_TIMELINE_ACTION("Batch decode");
+//   SEGMENT_TIMELINE_FUNC("softmax_func_");
+// and the caller brackets every Request / Prefill(n) / Execute(n) with
+//   SEGMENT_TIMELINE_SEGMENT("execute");
+// All scopes also go to the trace.h rings, so the exported Perfetto trace
+// shows segment > action > function nesting. The recorder sums calls and
+// time of every action and function per segment kind, so the report shows
+// which one dominates a segment.
+//
+// Host time ends when the call returns; kernel launches are asynchronous,
+// so it is the launch cost for device functions. With SetDeviceTimer() every
+// scope also records a device event at its start and end, without waiting;
+// the events are read when the segment ends, where its tokens come back to
+// the host anyway, so the engine runs as it does untimed. Device time is the
+// stream time between the two events, including idle gaps where the host
+// launched late. Build with -DSEGMENT_TIMELINE_CUDA=1 (and -lcudart) for
+// CudaEventTimer.
+//
+// Only what the engine reports is in the table: a segment kind with no rows
+// means the engine has not been instrumented. Build with -DSEGMENT_TRACE=0
+// to compile the scopes out.
+namespace timeline {
+
+enum class Category : uint8_t { kAction = 0, kFunc = 1 };
+
+// Device clock of the scopes. Record() enqueues an event on the device
+// stream and returns its handle; ElapsedUs() may wait for `end`. Handles stay
+// valid until Reset().
+class DeviceTimer {
+public:
+  virtual ~DeviceTimer() = default;
+  virtual int Record() = 0;
+  virtual double ElapsedUs(int begin, int end) = 0;
+  virtual void Reset() = 0;
+};
+
+#if SEGMENT_TIMELINE_CUDA
+// cudaEvent pairs on `stream` (the legacy default stream unless given).
+class CudaEventTimer : public DeviceTimer {
+public:
+  explicit CudaEventTimer(cudaStream_t stream = nullptr) : stream_(stream) {}
+  ~CudaEventTimer() override {
+    for (cudaEvent_t event : events_) cudaEventDestroy(event);
+  }
+
+  int Record() override {
+    if (next_ == events_.size()) {
+      cudaEvent_t event;
+      cudaEventCreate(&event);
+      events_.push_back(event);
+    }
+    cudaEventRecord(events_[next_], stream_);
+    return static_cast<int>(next_++);
+  }
+
+  double ElapsedUs(int begin, int end) override {
+    cudaEventSynchronize(events_[end]);
+    float ms = 0.0f;
+    cudaEventElapsedTime(&ms, events_[begin], events_[end]);
+    return ms * 1e3;
+  }
+
+  void Reset() override { next_ = 0; }
+
+private:
+  cudaStream_t stream_;
+  std::vector<cudaEvent_t> events_;
+  size_t next_ = 0;
+};
+#endif
+
+class Recorder {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static Recorder& Get() {
+    static Recorder recorder;
+    return recorder;
+  }
+
+  // nullptr: host time only.
+  void SetDeviceTimer(std::unique_ptr<DeviceTimer> timer) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    timer_ = std::move(timer);
+    pending_.clear();
+  }
+
+  // Printed above the tables, e.g. where the numbers come from.
+  void SetNote(std::string note) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    note_ = std::move(note);
+  }
+
+  // Device event handle, or -1 without a timer or outside a segment.
+  int RecordDeviceEvent() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (timer_ == nullptr || kind_ == nullptr) return -1;
+    return timer_->Record();
+  }
+
+  void BeginSegment(const std::string& kind) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    pending_.clear();
+    if (timer_ != nullptr) timer_->Reset();
+    kind_ = &kinds_[kind];
+    if (kind_->name.empty()) {
+      kind_->name = kind;
+      kind_order_.push_back(kind);
+    }
+  }
+
+  void EndSegment(Clock::duration wall) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (kind_ == nullptr) return;
+    kind_->wall.Record(wall);
+    for (const Pending& p : pending_) {
+      double us = timer_->ElapsedUs(p.begin, p.end);
+      kind_->entries[p.key].device += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(us));
+    }
+    pending_.clear();
+    kind_ = nullptr;
+  }
+
+  // Outside a segment (engine reload, background work) nothing is summed.
+  // `begin_event` / `end_event` come from RecordDeviceEvent() and are
+  // resolved in EndSegment.
+  void Add(Category category, uint32_t id, const char* name, Clock::duration host, int begin_event, int end_event) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (kind_ == nullptr) return;
+    Key key{category, id};
+    Entry& entry = kind_->entries[key];
+    entry.name = name;
+    entry.calls++;
+    entry.host += host;
+    if (timer_ != nullptr && begin_event >= 0 && end_event >= 0) pending_.push_back(Pending{key, begin_event, end_event});
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    kinds_.clear();
+    kind_order_.clear();
+    pending_.clear();
+    kind_ = nullptr;
+  }
+
+  // Per segment kind: mean calls, host and device time per segment of every
+  // action and function, and its share of the segment wall time.
+  void Print(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    if (!note_.empty()) out << "# " << note_ << std::endl;
+    for (const std::string& name : kind_order_) {
+      const Kind& kind = kinds_[name];
+      uint64_t segments = kind.wall.count();
+      if (segments == 0) continue;
+      double wall_us = kind.wall.mean() / 1e3;
+      out << "===========================" << std::endl;
+      out << "# " << name << " segments (" << segments << ", mean " << wall_us << "us, p99 "
+          << kind.wall.Percentile(99.0) / 1e3 << "us)" << std::endl;
+      out << std::left << std::setw(48) << "action / function" << std::right << std::setw(10) << "calls"
+          << std::setw(14) << "host_us" << std::setw(14) << "device_us" << std::setw(10) << "share" << std::endl;
+      if (kind.entries.empty()) {
+        out << "(no actions or functions recorded: the engine does not report them)" << std::endl;
+        continue;
+      }
+
+      std::vector<std::pair<Key, Entry>> rows(kind.entries.begin(), kind.entries.end());
+      std::stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        if (a.first.first != b.first.first) return a.first.first < b.first.first;
+        return std::max(a.second.host, a.second.device) > std::max(b.second.host, b.second.device);
+      });
+      for (const auto& [key, entry] : rows) {
+        double host_us = std::chrono::duration<double, std::micro>(entry.host).count() / segments;
+        double device_us = std::chrono::duration<double, std::micro>(entry.device).count() / segments;
+        std::string label = std::string(key.first == Category::kAction ? "[action] " : "  [func] ") + entry.name;
+        out << std::left << std::setw(48) << label << std::right << std::setw(10)
+            << static_cast<double>(entry.calls) / segments << std::setw(14) << host_us;
+        if (timer_ != nullptr) out << std::setw(14) << device_us;
+        else out << std::setw(14) << "-";
+        out << std::setw(9) << (wall_us > 0.0 ? std::max(host_us, device_us) / wall_us * 100.0 : 0.0) << "%"
+            << std::endl;
+      }
+    }
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+private:
+  using Key = std::pair<Category, uint32_t>;  // trace.h interned name
+  struct Entry {
+    const char* name = "";
+    uint64_t calls = 0;
+    Clock::duration host{0};
+    Clock::duration device{0};
+  };
+  struct Kind {
+    std::string name;
+    LatencyHistogram wall;
+    std::map<Key, Entry> entries;
+  };
+  struct Pending {
+    Key key;
+    int begin;
+    int end;
+  };
+
+  std::mutex mtx_;
+  std::unique_ptr<DeviceTimer> timer_;
+  std::vector<Pending> pending_;  // device events of the open segment
+  std::string note_;
+  std::map<std::string, Kind> kinds_;
+  std::vector<std::string> kind_order_;
+  Kind* kind_ = nullptr;
+};
+
+class SegmentScope {
+public:
+  SegmentScope(const char* kind, uint32_t trace_name)
+      : scope_(trace_name, 0), start_(Recorder::Clock::now()) {
+    Recorder::Get().BeginSegment(kind);
+  }
+  ~SegmentScope() { Recorder::Get().EndSegment(Recorder::Clock::now() - start_); }
+
+private:
+  trace::Scope scope_;
+  Recorder::Clock::time_point start_;
+};
+
+class Scope {
+public:
+  Scope(Category category, const char* name, uint32_t trace_name)
+      : category_(category), name_(name), trace_name_(trace_name), start_(Recorder::Clock::now()) {
+    trace::ThisThreadRing().Push(trace_name_, 0, trace::Phase::kBegin, 0);
+    begin_event_ = Recorder::Get().RecordDeviceEvent();
+  }
+
+  ~Scope() {
+    Recorder& recorder = Recorder::Get();
+    Recorder::Clock::time_point host_end = Recorder::Clock::now();
+    int end_event = begin_event_ >= 0 ? recorder.RecordDeviceEvent() : -1;
+    trace::ThisThreadRing().Push(trace_name_, 0, trace::Phase::kEnd, 0);
+    recorder.Add(category_, trace_name_, name_, host_end - start_, begin_event_, end_event);
+  }
+
+private:
+  Category category_;
+  const char* name_;
+  uint32_t trace_name_;
+  Recorder::Clock::time_point start_;
+  int begin_event_ = -1;
+};
+
+}  // namespace timeline
+
+#if SEGMENT_TRACE
+// `name` / `kind` must be string literals.
+#define SEGMENT_TIMELINE_SCOPE_(category, name)                                                \
+  static const uint32_t SEGMENT_TRACE_CONCAT(_timeline_id_, __LINE__) =                        \
+      ::trace::Registry::Get().InternName(name);                                               \
+  ::timeline::Scope SEGMENT_TRACE_CONCAT(_timeline_scope_, __LINE__)(                          \
+      (category), (name), SEGMENT_TRACE_CONCAT(_timeline_id_, __LINE__))
+#define SEGMENT_TIMELINE_ACTION(name) SEGMENT_TIMELINE_SCOPE_(::timeline::Category::kAction, name)
+#define SEGMENT_TIMELINE_FUNC(name) SEGMENT_TIMELINE_SCOPE_(::timeline::Category::kFunc, name)
+#define SEGMENT_TIMELINE_SEGMENT(kind)                                                         \
+  static const uint32_t SEGMENT_TRACE_CONCAT(_timeline_segment_id_, __LINE__) =                \
+      ::trace::Registry::Get().InternName(kind);                                               \
+  ::timeline::SegmentScope SEGMENT_TRACE_CONCAT(_timeline_segment_, __LINE__)(                 \
+      (kind), SEGMENT_TRACE_CONCAT(_timeline_segment_id_, __LINE__))
+#else
+#define SEGMENT_TIMELINE_ACTION(name) ((void)0)
+#define SEGMENT_TIMELINE_FUNC(name) ((void)0)
+#define SEGMENT_TIMELINE_SEGMENT(kind) ((void)0)
+#endif
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// (role, content), role is "system", "user" or "assistant".
+using SessionMessage = std::pair<std::string, std::string>;
+
+// Conversation template of the model, applied to a role-tagged dialog. The
+// defaults are Llama 3's (the models in this repo); take the strings from
+// conv_template in the model's mlc-chat-config.json for another model.
+struct ChatTemplate {
+  std::string begin = "<|begin_of_text|>";
+  std::string system_prefix = "<|start_header_id|>system<|end_header_id|>\n\n";
+  std::string user_prefix = "<|start_header_id|>user<|end_header_id|>\n\n";
+  std::string assistant_prefix = "<|start_header_id|>assistant<|end_header_id|>\n\n";
+  std::string end_of_turn = "<|eot_id|>";
+
+  std::string RenderMessage(const SessionMessage& message) const {
+    const std::string& prefix = message.first == "system" ? system_prefix
+                              : message.first == "assistant" ? assistant_prefix : user_prefix;
+    return prefix + message.second + end_of_turn;
+  }
+
+  // The dialog followed by the assistant prefix the model continues from.
+  std::string Render(const std::vector<SessionMessage>& messages) const {
+    std::string prompt = begin;
+    for (const SessionMessage& message : messages) prompt += RenderMessage(message);
+    return prompt + assistant_prefix;
+  }
+};
+
+// Multi-turn sessions on top of a SegmentRunner-like `Runner`.
+//
+// SegmentRunner::Request starts a fresh sequence. A runner with
+// Request(const std::vector<SessionMessage>&, int) gets each turn as one
+// request carrying the whole dialog as role-tagged messages (the system
+// message, every earlier user and assistant turn, then the new user text)
+// and applies the model's template itself, like a chat completion request.
+// An earlier turn then renders to the tokens the engine already saw, so the
+// prefix cache can match them; whether prefill per turn stays flat has to
+// be measured on that runner.
+//
+// The fork's SegmentRunner has only Request(prompt, max_tokens), which
+// applies the chat template to `prompt` as a single user turn. Passing it a
+// rendered dialog would nest the template, and no turn would share a prefix
+// with the last one. Such a runner gets the new user text only
+// (kSendsDialog is false): the dialog is kept for Transcript() and the
+// limits below, but the model does not see earlier turns and nothing is
+// reused.
+//
+// Memory is bounded explicitly: a dialog whose rendered size exceeds
+// `max_context_chars` or with more than `max_turns` turns drops its oldest
+// turns (the next turn then re-prefills the shortened dialog once), and
+// opening more than `max_sessions` sessions closes the least recently used
+// one. Eviction changes the prefix, so it is counted in the stats.
+//
+// Sessions share the runner; one turn is live at a time.
+template <typename Runner>
+class SessionSegmentRunner {
+public:
+  struct Limits {
+    int max_sessions = 8;
+    size_t max_context_chars = 16384;  // rendered dialog, see Transcript()
+    int max_turns = 0;  // 0: bounded by max_context_chars only
+    std::string system_message;
+    ChatTemplate chat_template;
+  };
+
+  struct SessionStats {
+    int turns = 0;
+    int evicted_turns = 0;
+    size_t context_chars = 0;       // rendered dialog including the running reply
+    int last_prefill_segments = 0;  // Request + Prefill calls of the last turn
+  };
+
+  // Whether the runner receives the dialog (a messages Request) or only the new user text.
+  static constexpr bool kSendsDialog = requires(Runner& r, const std::vector<SessionMessage>& m) { r.Request(m, 0); };
+
+  SessionSegmentRunner(Runner& runner, Limits limits) : runner_(runner), limits_(std::move(limits)) {}
+
+  int Open() {
+    if (static_cast<int>(sessions_.size()) >= limits_.max_sessions) {
+      int lru = -1;
+      for (auto& [id, session] : sessions_) {
+        if (id == active_ && !runner_.IsEnd()) continue;  // turn still running
+        if (lru < 0 || session.last_used < sessions_[lru].last_used) lru = id;
+      }
+      if (lru >= 0) Close(lru);
+    }
+    int id = next_id_++;
+    sessions_[id].last_used = ++clock_;
+    return id;
+  }
+
+  void Close(int session) {
+    if (session == active_) active_ = -1;
+    sessions_.erase(session);
+  }
+
+  // Start the next turn of `session`. The previous turn must have ended.
+  void AppendTurn(int session, const std::string& user_text, int max_tokens) {
+    if (active_ >= 0 && !runner_.IsEnd()) throw std::runtime_error("SessionSegmentRunner: a turn is still running");
+    Session& s = Get(session);
+    s.turns.push_back(Turn{user_text, ""});
+    Evict(s);
+    s.last_used = ++clock_;
+    s.stats.turns++;
+    s.stats.last_prefill_segments = 1;
+    active_ = session;
+    if constexpr (kSendsDialog) {
+      runner_.Request(Messages(s), max_tokens);
+    } else {
+      runner_.Request(user_text, max_tokens);  // templated by the runner as one user turn
+    }
+  }
+
+  void Prefill(int n) {
+    runner_.Prefill(n);
+    if (active_ >= 0) Get(active_).stats.last_prefill_segments++;
+  }
+
+  bool IsPrefillEnd() { return runner_.IsPrefillEnd(); }
+
+  std::string Execute(int n) {
+    std::string delta = runner_.Execute(n);
+    if (active_ >= 0) {
+      Session& s = Get(active_);
+      s.turns.back().assistant += delta;
+      s.stats.context_chars = ContextChars(s);
+    }
+    return delta;
+  }
+
+  bool IsEnd() { return runner_.IsEnd(); }
+
+  // Rendered dialog of `session` so far, the prefix of its next turn.
+  std::string Transcript(int session) {
+    Session& s = Get(session);
+    std::string transcript = limits_.chat_template.begin;
+    if (!limits_.system_message.empty()) transcript += limits_.chat_template.RenderMessage({"system", limits_.system_message});
+    for (const Turn& turn : s.turns) transcript += TurnText(turn);
+    return transcript;
+  }
+
+  const SessionStats& stats(int session) { return Get(session).stats; }
+  int num_sessions() const { return static_cast<int>(sessions_.size()); }
+
+private:
+  struct Turn {
+    std::string user;
+    std::string assistant;
+  };
+
+  struct Session {
+    std::deque<Turn> turns;
+    SessionStats stats;
+    uint64_t last_used = 0;
+  };
+
+  Session& Get(int session) {
+    auto it = sessions_.find(session);
+    if (it == sessions_.end()) throw std::out_of_range("SessionSegmentRunner: unknown session " + std::to_string(session));
+    return it->second;
+  }
+
+  std::string TurnText(const Turn& turn) const {
+    return limits_.chat_template.RenderMessage({"user", turn.user}) +
+           limits_.chat_template.RenderMessage({"assistant", turn.assistant});
+  }
+
+  // Size of Transcript(), the one accounting used for stats and eviction.
+  size_t ContextChars(const Session& s) const {
+    size_t chars = limits_.chat_template.begin.size();
+    if (!limits_.system_message.empty()) {
+      chars += limits_.chat_template.RenderMessage({"system", limits_.system_message}).size();
+    }
+    for (const Turn& turn : s.turns) chars += TurnText(turn).size();
+    return chars;
+  }
+
+  // Drop the oldest turns until the dialog fits; the newest turn is always kept.
+  void Evict(Session& s) {
+    while (s.turns.size() > 1 &&
+           (ContextChars(s) > limits_.max_context_chars ||
+            (limits_.max_turns > 0 && static_cast<int>(s.turns.size()) > limits_.max_turns))) {
+      s.turns.pop_front();
+      s.stats.evicted_turns++;
+    }
+    s.stats.context_chars = ContextChars(s);
+  }
+
+  // System message, earlier turns with their replies, then the new user text.
+  std::vector<SessionMessage> Messages(const Session& s) const {
+    std::vector<SessionMessage> messages;
+    if (!limits_.system_message.empty()) messages.emplace_back("system", limits_.system_message);
+    for (size_t i = 0; i + 1 < s.turns.size(); ++i) {
+      messages.emplace_back("user", s.turns[i].user);
+      messages.emplace_back("assistant", s.turns[i].assistant);
+    }
+    messages.emplace_back("user", s.turns.back().user);
+    return messages;
+  }
+
+  Runner& runner_;
+  Limits limits_;
+  std::map<int, Session> sessions_;
+  int next_id_ = 0;
+  int active_ = -1;
+  uint64_t clock_ = 0;
+};
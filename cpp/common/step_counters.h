@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-step packed-function call counts at instrumented call sites.
+//
+// StepCallCounter counts packed-function (FFI) calls per step:
+//   SEGMENT_FFI_CALL("mlc.serve.RequestStreamOutputUnpack");
+// at every call site and StepCallCounter::Get().EndStep() when a step
+// finishes. Print() lists calls per step of every function, so a step that
+// starts making a redundant query shows up as a changed row.
+//
+// Only call sites carrying SEGMENT_FFI_CALL are counted. The engine step
+// loop lives in the mlc-llm fork and has none, so against the real engine
+// the counts cover the caller's side (CppInterface) only; the mock
+// SegmentRunner counts the calls it scripts, not measured ones. Print()
+// takes a title saying which of the two a table is.
+
+// Calls between two EndStep() belong to the step the second one closes.
+class StepCallCounter {
+public:
+  static constexpr size_t kMaxFuncs = 128;
+
+  static StepCallCounter& Get() {
+    static StepCallCounter counter;
+    return counter;
+  }
+
+  uint32_t Intern(const char* name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (size_t i = 0; i < names_.size(); ++i) {
+      if (std::strcmp(names_[i], name) == 0) return static_cast<uint32_t>(i);
+    }
+    if (names_.size() == kMaxFuncs) return kMaxFuncs - 1;  // shares the last slot
+    names_.push_back(name);
+    return static_cast<uint32_t>(names_.size() - 1);
+  }
+
+  void Count(uint32_t id) { step_[id].fetch_add(1, std::memory_order_relaxed); }
+
+  void EndStep() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint64_t step_total = 0;
+    for (size_t i = 0; i < names_.size(); ++i) {
+      uint64_t calls = step_[i].exchange(0, std::memory_order_relaxed);
+      total_[i] += calls;
+      max_[i] = std::max(max_[i], calls);
+      step_total += calls;
+    }
+    steps_++;
+    calls_ += step_total;
+    max_step_calls_ = std::max(max_step_calls_, step_total);
+  }
+
+  uint64_t steps() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return steps_;
+  }
+
+  double CallsPerStep() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return steps_ == 0 ? 0.0 : static_cast<double>(calls_) / steps_;
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (size_t i = 0; i < kMaxFuncs; ++i) {
+      step_[i].store(0, std::memory_order_relaxed);
+      total_[i] = 0;
+      max_[i] = 0;
+    }
+    steps_ = 0;
+    calls_ = 0;
+    max_step_calls_ = 0;
+  }
+
+  void Print(std::ostream& out, const std::string& title) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    out << "===========================" << std::endl;
+    out << "# " << title << " (" << steps_ << " steps)" << std::endl;
+    out << std::left << std::setw(48) << "function" << std::right << std::setw(10) << "mean" << std::setw(10)
+        << "max" << std::setw(12) << "total" << std::endl;
+    double steps = std::max<uint64_t>(steps_, 1);
+    for (size_t i = 0; i < names_.size(); ++i) {
+      if (total_[i] == 0) continue;
+      out << std::left << std::setw(48) << names_[i] << std::right << std::setw(10) << total_[i] / steps
+          << std::setw(10) << max_[i] << std::setw(12) << total_[i] << std::endl;
+    }
+    out << std::left << std::setw(48) << "all" << std::right << std::setw(10) << calls_ / steps << std::setw(10)
+        << max_step_calls_ << std::setw(12) << calls_ << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+private:
+  StepCallCounter() = default;
+
+  std::mutex mtx_;
+  std::vector<const char*> names_;
+  std::atomic<uint64_t> step_[kMaxFuncs] = {};
+  uint64_t total_[kMaxFuncs] = {};
+  uint64_t max_[kMaxFuncs] = {};
+  uint64_t steps_ = 0;
+  uint64_t calls_ = 0;
+  uint64_t max_step_calls_ = 0;
+};
+
+// `name` must be a string literal.
+#define SEGMENT_FFI_CALL(name)                                                    \
+  do {                                                                            \
+    static const uint32_t _ffi_call_id = ::StepCallCounter::Get().Intern(name);   \
+    ::StepCallCounter::Get().Count(_ffi_call_id);                                 \
+  } while (0)
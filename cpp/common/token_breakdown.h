@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "latency_histogram.h"
+
+// Per-step wall-time breakdown of the interface stream path.
+//
+// One engine step produces one stream-back batch, which travels
+//   engine step -> stream-back callback -> queue -> unpack -> detokenize
+//   -> response construction -> caller
+// The wall time of a step is the interval between two consecutive outputs
+// reaching the caller. It is split into the stages below so that they add
+// up to it exactly: the callback and the queue handoff are clipped to the
+// interval, and the engine step is whatever elapsed before the callback ran
+// (time the caller spent waiting for the device plus the engine's own
+// bookkeeping).
+//
+// CallbackEnter/CallbackExit run on the stream-back thread, everything else
+// on the consuming thread. evaluation/08_overhead_breakdown/python_breakdown.py
+// applies the same stages to the Python engine.
+enum class TokenStage : int {
+  kEngineStep = 0,
+  kCallback,
+  kQueueHandoff,
+  kUnpack,
+  kDetokenize,
+  kResponse,
+  kCallerWakeup,
+  kCount,
+};
+
+class TokenBreakdown {
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr int kNumStages = static_cast<int>(TokenStage::kCount);
+
+  static const char* StageName(TokenStage stage) {
+    static const char* kNames[kNumStages] = {"engine step", "stream-back callback", "queue handoff", "unpack",
+                                             "detokenize", "response construction", "caller wakeup"};
+    return kNames[static_cast<int>(stage)];
+  }
+
+  // Request submitted; the first step is measured from here.
+  void Begin() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      pending_.clear();
+    }
+    prev_received_ = last_ = Clock::now();
+    active_ = false;
+  }
+
+  void CallbackEnter() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    pending_.push_back({Clock::now(), Clock::time_point()});
+  }
+
+  void CallbackExit() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!pending_.empty()) pending_.back().exit = Clock::now();
+  }
+
+  // Batch taken off the queue by the consumer.
+  void Dequeued() {
+    Clock::time_point now = Clock::now();
+    Callback callback{now, now};
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (!pending_.empty()) {
+        callback = pending_.front();
+        pending_.pop_front();
+      }
+    }
+    // A batch that never reached the caller (final usage chunk) is dropped.
+    stages_.fill(Clock::duration::zero());
+    tokens_ = 0;
+    active_ = true;
+    Clock::time_point enter = std::max(callback.enter, prev_received_);
+    Clock::time_point exit = std::max(callback.exit, enter);
+    stages_[Index(TokenStage::kEngineStep)] = enter - prev_received_;
+    stages_[Index(TokenStage::kCallback)] = exit - enter;
+    stages_[Index(TokenStage::kQueueHandoff)] = now - exit;
+    last_ = now;
+  }
+
+  // Time since the previous mark is charged to `stage`.
+  void Mark(TokenStage stage) {
+    if (!active_) return;
+    Clock::time_point now = Clock::now();
+    stages_[Index(stage)] += now - last_;
+    last_ = now;
+  }
+
+  void AddTokens(int n) { tokens_ += n; }
+
+  // Output handed to the caller: closes the step.
+  void Received() {
+    if (!active_) return;
+    Mark(TokenStage::kCallerWakeup);
+    active_ = false;
+    if (tokens_ == 0) return;
+    for (int i = 0; i < kNumStages; ++i) histograms_[i].Record(stages_[i]);
+    wall_.Record(last_ - prev_received_);
+    num_tokens_ += tokens_;
+    prev_received_ = last_;
+  }
+
+  const LatencyHistogram& stage(TokenStage stage) const { return histograms_[Index(stage)]; }
+  const LatencyHistogram& wall() const { return wall_; }
+  uint64_t num_tokens() const { return num_tokens_; }
+
+  void Clear() {
+    for (auto& h : histograms_) h.Clear();
+    wall_.Clear();
+    num_tokens_ = 0;
+  }
+
+  void Print(std::ostream& out, const std::string& title) const {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    double wall_mean = wall_.mean();
+    out << std::fixed << std::setprecision(3);
+    out << "===========================" << std::endl;
+    out << "# " << title << " (" << wall_.count() << " steps, " << num_tokens_ << " tokens)" << std::endl;
+    out << std::left << std::setw(24) << "stage" << std::right << std::setw(12) << "mean_us" << std::setw(12)
+        << "p50_us" << std::setw(12) << "p99_us" << std::setw(10) << "share" << std::endl;
+    auto row = [&](const std::string& name, const LatencyHistogram& h) {
+      out << std::left << std::setw(24) << name << std::right << std::setw(12) << h.mean() / 1e3 << std::setw(12)
+          << h.Percentile(50.0) / 1e3 << std::setw(12) << h.Percentile(99.0) / 1e3 << std::setw(9)
+          << (wall_mean > 0.0 ? h.mean() / wall_mean * 100.0 : 0.0) << "%" << std::endl;
+    };
+    for (int i = 0; i < kNumStages; ++i) row(StageName(static_cast<TokenStage>(i)), histograms_[i]);
+    row("wall", wall_);
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+private:
+  struct Callback {
+    Clock::time_point enter;
+    Clock::time_point exit;
+  };
+
+  static int Index(TokenStage stage) { return static_cast<int>(stage); }
+
+  std::mutex mtx_;
+  std::deque<Callback> pending_;
+  Clock::time_point prev_received_;
+  Clock::time_point last_;
+  bool active_ = false;
+  std::array<Clock::duration, kNumStages> stages_{};
+  int tokens_ = 0;
+  std::array<LatencyHistogram, kNumStages> histograms_;
+  LatencyHistogram wall_;
+  uint64_t num_tokens_ = 0;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Caller-owned output buffer for generated token ids.
+//
+// The producer (the engine stream-back callback) appends token ids, and
+// optionally a per-token timestamp, into storage provided by the caller, so
+// no per-segment string is allocated and nothing is detokenized on the way.
+// When the buffer is full a span drops further tokens (counted in
+// dropped()), a ring overwrites the oldest ones. Tokens are addressed by
+// their absolute index in the stream; a ring keeps the last capacity().
+//
+// One producer and one consumer thread; the consumer sees every token up
+// to total() once it has loaded it. A ring slot can be overwritten while the
+// consumer reads it, so a concurrent consumer of a ring reads with Read(),
+// which reports a token that was overwritten meanwhile (seqlock-style check
+// against the producer's claim counter) instead of returning a wrong id.
+// id() and timestamp_ns() are for a span, or for a ring whose producer has
+// stopped. Clear() must not race with Append().
+class TokenSink {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  TokenSink(int32_t* ids, size_t capacity, int64_t* timestamps_ns = nullptr, bool ring = false)
+      : ids_(ids), timestamps_ns_(timestamps_ns), capacity_(capacity), ring_(ring) {
+    if (capacity_ == 0) throw std::invalid_argument("TokenSink: capacity must be positive");
+  }
+
+  template <typename Int>
+  size_t Append(const Int* ids, size_t n) {
+    size_t total = total_.load(std::memory_order_relaxed);
+    size_t written = ring_ ? n : std::min(n, capacity_ - std::min(total, capacity_));
+    // Announce the slots about to be overwritten before touching them.
+    claimed_.store(total + written, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    int64_t now = timestamps_ns_ != nullptr ? Now() : 0;
+    for (size_t i = 0; i < written; ++i, ++total) {
+      size_t slot = total % capacity_;
+      std::atomic_ref<int32_t>(ids_[slot]).store(static_cast<int32_t>(ids[i]), std::memory_order_relaxed);
+      if (timestamps_ns_ != nullptr) {
+        std::atomic_ref<int64_t>(timestamps_ns_[slot]).store(now, std::memory_order_relaxed);
+      }
+    }
+    if (written < n) dropped_.fetch_add(n - written, std::memory_order_relaxed);
+    total_.store(total, std::memory_order_release);
+    return written;
+  }
+
+  // Token `index` (and its timestamp) if it is still held; false if it was
+  // not appended yet or was overwritten before or while it was read.
+  bool Read(size_t index, int32_t* id, int64_t* timestamp_ns = nullptr) const {
+    if (index >= total()) return false;
+    size_t slot = index % capacity_;
+    int32_t value = std::atomic_ref<int32_t>(ids_[slot]).load(std::memory_order_relaxed);
+    int64_t time = timestamps_ns_ != nullptr
+        ? std::atomic_ref<int64_t>(timestamps_ns_[slot]).load(std::memory_order_relaxed) : 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (claimed_.load(std::memory_order_relaxed) > index + capacity_) return false;
+    *id = value;
+    if (timestamp_ns != nullptr) *timestamp_ns = time;
+    return true;
+  }
+
+  // Tokens appended so far, including the ones a ring already overwrote.
+  size_t total() const { return total_.load(std::memory_order_acquire); }
+  // First index still held.
+  size_t begin() const {
+    size_t total = this->total();
+    return total > capacity_ ? total - capacity_ : 0;
+  }
+  size_t capacity() const { return capacity_; }
+  size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  int32_t id(size_t index) const { return ids_[index % capacity_]; }
+  int64_t timestamp_ns(size_t index) const {
+    return timestamps_ns_ != nullptr ? timestamps_ns_[index % capacity_] : 0;
+  }
+
+  void Clear() {
+    claimed_.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_release);
+    dropped_.store(0, std::memory_order_relaxed);
+  }
+
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+  }
+
+private:
+  int32_t* ids_;
+  int64_t* timestamps_ns_;
+  size_t capacity_;
+  bool ring_;
+  std::atomic<size_t> total_{0};
+  std::atomic<size_t> claimed_{0};  // total() once the Append in progress finishes
+  std::atomic<size_t> dropped_{0};
+};
+
+// On-demand detokenization of a TokenSink. `put` is an incremental decoder
+// such as mlc::llm::TextStreamer::Put; only tokens not decoded yet are
+// passed to it, and only when the text is asked for.
+class LazyDetokenizer {
+public:
+  using PutFunc = std::function<std::string(const std::vector<int32_t>&)>;
+
+  LazyDetokenizer(const TokenSink& sink, PutFunc put) : sink_(sink), put_(std::move(put)) {}
+
+  // Text of the tokens appended since the last call.
+  std::string Pull() {
+    size_t total = sink_.total();
+    if (total == next_) return "";
+    // Tokens a ring overwrote before they were decoded are skipped.
+    next_ = std::max(next_, sink_.begin());
+    pending_.clear();
+    while (next_ < total) {
+      int32_t id;
+      if (sink_.Read(next_, &id)) {
+        pending_.push_back(id);
+        next_++;
+      } else {
+        next_ = std::max(next_ + 1, sink_.begin());
+      }
+    }
+    std::string delta = put_(pending_);
+    text_ += delta;
+    return delta;
+  }
+
+  const std::string& Text() {
+    Pull();
+    return text_;
+  }
+
+private:
+  const TokenSink& sink_;
+  PutFunc put_;
+  size_t next_ = 0;
+  std::vector<int32_t> pending_;
+  std::string text_;
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Tokenization service: encodes batches of prompts on a worker pool and keeps
+// a bounded LRU cache keyed by a content hash, so repeated documents and
+// system prompts skip encoding entirely.
+//
+// The HF tokenizer behind mlc::llm::Tokenizer keeps the last encoding inside
+// its handle, so one tokenizer must not be shared between threads. Each worker
+// therefore builds its own encoder through `EncoderFactory`.
+class TokenizerService {
+public:
+  using TokenVec = std::vector<int32_t>;
+  using EncodeFunc = std::function<TokenVec(const std::string&)>;
+  using EncoderFactory = std::function<EncodeFunc(int worker_index)>;
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  TokenizerService(EncoderFactory make_encoder, int num_threads = 1, size_t cache_capacity = 256)
+      : cache_capacity_(cache_capacity) {
+    if (num_threads < 1) num_threads = 1;
+    for (int i = 0; i < num_threads; ++i) {
+      workers_.emplace_back([this, encode = make_encoder(i)]() { WorkerLoop(encode); });
+    }
+  }
+
+  ~TokenizerService() {
+    {
+      std::lock_guard<std::mutex> lock(task_mtx_);
+      stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+  }
+
+  TokenizerService(const TokenizerService&) = delete;
+  TokenizerService& operator=(const TokenizerService&) = delete;
+
+  TokenVec Encode(const std::string& text) {
+    return EncodeBatch({text})[0];
+  }
+
+  // Encode all texts. Cached texts are answered on the caller thread, the
+  // remaining ones (deduplicated within the batch) are spread over the pool.
+  std::vector<TokenVec> EncodeBatch(const std::vector<std::string>& texts) {
+    struct Job {
+      uint64_t key;
+      bool cacheable;
+      std::vector<size_t> indices;
+      std::future<TokenVec> future;
+    };
+    std::vector<TokenVec> outputs(texts.size());
+    std::vector<Job> jobs;
+    std::unordered_map<uint64_t, size_t> job_of_key;
+
+    for (size_t i = 0; i < texts.size(); ++i) {
+      uint64_t key = HashContent(texts[i]);
+      if (LookupCache(key, texts[i], outputs[i])) continue;
+
+      auto it = job_of_key.find(key);
+      if (it != job_of_key.end() && texts[jobs[it->second].indices[0]] == texts[i]) {
+        jobs[it->second].indices.push_back(i);
+        continue;
+      }
+      // A hash collision inside one batch is encoded on its own and not cached.
+      bool cacheable = it == job_of_key.end();
+      if (cacheable) job_of_key[key] = jobs.size();
+      jobs.push_back(Job{key, cacheable, {i}, Submit(texts[i])});
+    }
+
+    for (Job& job : jobs) {
+      TokenVec tokens = job.future.get();
+      if (job.cacheable) InsertCache(job.key, texts[job.indices[0]], tokens);
+      for (size_t idx : job.indices) outputs[idx] = tokens;
+    }
+    return outputs;
+  }
+
+  Stats GetStats() const {
+    std::lock_guard<std::mutex> lock(cache_mtx_);
+    return stats_;
+  }
+
+  void ClearCache() {
+    std::lock_guard<std::mutex> lock(cache_mtx_);
+    lru_.clear();
+    index_.clear();
+    stats_ = Stats();
+  }
+
+  int NumThreads() const { return static_cast<int>(workers_.size()); }
+
+  // 64-bit FNV-1a. The cache still compares the full text on a hit.
+  static uint64_t HashContent(const std::string& text) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : text) {
+      hash ^= c;
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+private:
+  struct CacheEntry {
+    uint64_t key;
+    std::string text;
+    TokenVec tokens;
+  };
+
+  std::future<TokenVec> Submit(const std::string& text) {
+    auto task = std::make_shared<std::packaged_task<TokenVec(const EncodeFunc&)>>(
+        [text](const EncodeFunc& encode) { return encode(text); });
+    std::future<TokenVec> future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(task_mtx_);
+      tasks_.push([task](const EncodeFunc& encode) { (*task)(encode); });
+    }
+    task_cv_.notify_one();
+    return future;
+  }
+
+  void WorkerLoop(const EncodeFunc& encode) {
+    while (true) {
+      std::function<void(const EncodeFunc&)> task;
+      {
+        std::unique_lock<std::mutex> lock(task_mtx_);
+        task_cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        if (stop_ && tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task(encode);
+    }
+  }
+
+  bool LookupCache(uint64_t key, const std::string& text, TokenVec& output) {
+    std::lock_guard<std::mutex> lock(cache_mtx_);
+    auto it = index_.find(key);
+    if (it == index_.end() || it->second->text != text) {
+      ++stats_.misses;
+      return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    output = it->second->tokens;
+    ++stats_.hits;
+    return true;
+  }
+
+  void InsertCache(uint64_t key, const std::string& text, const TokenVec& tokens) {
+    if (cache_capacity_ == 0) return;
+    std::lock_guard<std::mutex> lock(cache_mtx_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      // Same hash: the newest text wins the slot.
+      it->second->text = text;
+      it->second->tokens = tokens;
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return;
+    }
+    lru_.push_front(CacheEntry{key, text, tokens});
+    index_[key] = lru_.begin();
+    if (lru_.size() > cache_capacity_) {
+      index_.erase(lru_.back().key);
+      lru_.pop_back();
+      ++stats_.evictions;
+    }
+  }
+
+  // worker pool
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void(const EncodeFunc&)>> tasks_;
+  std::mutex task_mtx_;
+  std::condition_variable task_cv_;
+  bool stop_ = false;
+
+  // LRU cache, most recently used at the front
+  size_t cache_capacity_;
+  std::list<CacheEntry> lru_;
+  std::unordered_map<uint64_t, std::list<CacheEntry>::iterator> index_;
+  mutable std::mutex cache_mtx_;
+  Stats stats_;
+};
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Low-overhead tracing for the interface hot path.
+//
+// Every thread writes fixed-size records into its own ring buffer (single
+// producer, no locks, no allocation). When a thread exits its ring goes back
+// to the registry and the next new thread reuses it, so memory is bounded by
+// the peak number of live threads; the records of an exited thread are
+// exported until its ring is reused. Event names are interned once per call
+// site and timestamps are raw TSC ticks, converted to wall time only when the
+// trace is exported as Chrome trace JSON or as a Perfetto protobuf trace.
+//
+// Build with -DSEGMENT_TRACE=0 to compile every trace macro out.
+#ifndef SEGMENT_TRACE
+#define SEGMENT_TRACE 1
+#endif
+
+// Number of records kept per thread (power of two). Older records are overwritten.
+#ifndef SEGMENT_TRACE_RING_SIZE
+#define SEGMENT_TRACE_RING_SIZE (1 << 16)
+#endif
+
+namespace trace {
+
+enum class Phase : uint8_t { kBegin = 0, kEnd = 1, kInstant = 2 };
+
+struct Event {
+  uint64_t tsc;
+  int64_t value;
+  uint32_t name;
+  uint16_t track;
+  Phase phase;
+};
+
+inline uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+class Ring {
+public:
+  static constexpr uint64_t kMask = SEGMENT_TRACE_RING_SIZE - 1;
+  static_assert((SEGMENT_TRACE_RING_SIZE & kMask) == 0, "SEGMENT_TRACE_RING_SIZE must be a power of two");
+
+  Ring(uint32_t tid, std::string name)
+      : events_(new Event[SEGMENT_TRACE_RING_SIZE]), tid_(tid), name_(std::move(name)) {}
+
+  inline void Push(uint32_t name, uint16_t track, Phase phase, int64_t value) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    Event& e = events_[head & kMask];
+    e.tsc = Now();
+    e.value = value;
+    e.name = name;
+    e.track = track;
+    e.phase = phase;
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  // Copy the retained records, oldest first. Records written while the
+  // snapshot is taken may be torn, so export once the traced work is idle.
+  std::vector<Event> Snapshot() const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t begin = head > SEGMENT_TRACE_RING_SIZE ? head - SEGMENT_TRACE_RING_SIZE : 0;
+    std::vector<Event> out;
+    out.reserve(head - begin);
+    for (uint64_t i = begin; i < head; ++i) out.push_back(events_[i & kMask]);
+    return out;
+  }
+
+  void Clear() { head_.store(0, std::memory_order_release); }
+
+  uint32_t tid() const { return tid_; }
+  const std::string& name() const { return name_; }
+  void set_name(std::string name) { name_ = std::move(name); }
+  void set_tid(uint32_t tid) { tid_ = tid; }
+
+private:
+  std::unique_ptr<Event[]> events_;
+  std::atomic<uint64_t> head_{0};
+  uint32_t tid_;
+  std::string name_;
+};
+
+// Process-wide tables of interned names, tracks and per-thread rings.
+// Only first use of a call site, a track or a thread takes the lock.
+class Registry {
+public:
+  static Registry& Get() {
+    static Registry registry;
+    return registry;
+  }
+
+  uint32_t InternName(const char* name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = name_ids_.find(name);
+    if (it != name_ids_.end()) return it->second;
+    names_.push_back(name);
+    return name_ids_[name] = static_cast<uint32_t>(names_.size() - 1);
+  }
+
+  // Tracks group events of one logical stream, e.g. one request id.
+  // Track 0 is the default track of the emitting thread; once every id is
+  // live, new streams fall back to it. Interning is counted: the id goes
+  // back to the table when the last ReleaseTrack() of its name runs. A
+  // released id keeps its name for export until it is handed out again,
+  // oldest released first.
+  uint16_t InternTrack(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = track_ids_.find(name);
+    if (it != track_ids_.end()) {
+      ++track_refs_[it->second];
+      return it->second;
+    }
+    uint16_t id;
+    if (!free_tracks_.empty()) {
+      id = free_tracks_.front();
+      free_tracks_.pop_front();
+      tracks_[id] = name;
+    } else if (tracks_.size() <= UINT16_MAX) {
+      id = static_cast<uint16_t>(tracks_.size());
+      tracks_.push_back(name);
+      track_refs_.push_back(0);
+    } else {
+      return 0;
+    }
+    track_refs_[id] = 1;
+    return track_ids_[name] = id;
+  }
+
+  void ReleaseTrack(uint16_t id) {
+    if (id == 0) return;
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (id >= track_refs_.size() || track_refs_[id] == 0 || --track_refs_[id] > 0) return;
+    track_ids_.erase(tracks_[id]);
+    free_tracks_.push_back(id);
+  }
+
+  Ring* RegisterThread() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint32_t tid = next_tid_++;
+    if (!free_rings_.empty()) {
+      Ring* ring = free_rings_.back();
+      free_rings_.pop_back();
+      ring->Clear();
+      ring->set_tid(tid);
+      ring->set_name("thread " + std::to_string(tid));
+      return ring;
+    }
+    rings_.push_back(std::make_unique<Ring>(tid, "thread " + std::to_string(tid)));
+    return rings_.back().get();
+  }
+
+  void RenameThread(Ring* ring, std::string name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    ring->set_name(std::move(name));
+  }
+
+  // Called when the owning thread exits.
+  void ReleaseThread(Ring* ring) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    free_rings_.push_back(ring);
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& ring : rings_) ring->Clear();
+  }
+
+  // Nanoseconds per timestamp tick, measured against steady_clock since startup.
+  double NsPerTick() const {
+    uint64_t tsc = Now();
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - base_time_).count();
+    if (tsc <= base_tsc_ || ns <= 0) return 1.0;
+#if defined(__x86_64__) || defined(__i386__)
+    return static_cast<double>(ns) / static_cast<double>(tsc - base_tsc_);
+#else
+    return 1.0;
+#endif
+  }
+
+  uint64_t base_tsc() const { return base_tsc_; }
+
+  struct ThreadEvents {
+    uint32_t tid;
+    std::string name;
+    std::vector<Event> events;
+  };
+
+  std::vector<ThreadEvents> Collect(std::vector<std::string>& names, std::vector<std::string>& tracks) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    names = names_;
+    tracks = tracks_;
+    std::vector<ThreadEvents> out;
+    for (auto& ring : rings_) out.push_back({ring->tid(), ring->name(), ring->Snapshot()});
+    return out;
+  }
+
+private:
+  Registry() : base_tsc_(Now()), base_time_(std::chrono::steady_clock::now()) {
+    tracks_.push_back("");
+    track_refs_.push_back(1);
+    track_ids_[""] = 0;
+  }
+
+  std::mutex mtx_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, uint32_t> name_ids_;
+  std::vector<std::string> tracks_;
+  std::unordered_map<std::string, uint16_t> track_ids_;
+  std::vector<uint32_t> track_refs_;
+  std::deque<uint16_t> free_tracks_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::vector<Ring*> free_rings_;
+  uint32_t next_tid_ = 0;
+  uint64_t base_tsc_;
+  std::chrono::steady_clock::time_point base_time_;
+};
+
+// Returns the thread's ring to the registry when the thread exits.
+class RingLease {
+public:
+  RingLease() : ring_(Registry::Get().RegisterThread()) {}
+  ~RingLease() { Registry::Get().ReleaseThread(ring_); }
+  RingLease(const RingLease&) = delete;
+  RingLease& operator=(const RingLease&) = delete;
+
+  Ring& ring() { return *ring_; }
+
+private:
+  Ring* ring_;
+};
+
+inline Ring& ThisThreadRing() {
+  thread_local RingLease lease;
+  return lease.ring();
+}
+
+inline void SetThreadName(const std::string& name) {
+  Registry::Get().RenameThread(&ThisThreadRing(), name);
+}
+
+inline uint16_t InternTrack(const std::string& name) {
+#if SEGMENT_TRACE
+  return Registry::Get().InternTrack(name);
+#else
+  return 0;
+#endif
+}
+
+inline void ReleaseTrack(uint16_t track) {
+#if SEGMENT_TRACE
+  Registry::Get().ReleaseTrack(track);
+#else
+  (void)track;
+#endif
+}
+
+// Holds a track for its lifetime, e.g. for one request: intern the id once
+// and pass id() down the hot path instead of the name.
+class TrackLease {
+public:
+  explicit TrackLease(const std::string& name) : track_(InternTrack(name)) {}
+  ~TrackLease() { ReleaseTrack(track_); }
+  TrackLease(const TrackLease&) = delete;
+  TrackLease& operator=(const TrackLease&) = delete;
+
+  uint16_t id() const { return track_; }
+
+private:
+  uint16_t track_;
+};
+
+class Scope {
+public:
+  Scope(uint32_t name, uint16_t track) : name_(name), track_(track) {
+    ThisThreadRing().Push(name_, track_, Phase::kBegin, 0);
+  }
+  ~Scope() { ThisThreadRing().Push(name_, track_, Phase::kEnd, 0); }
+
+private:
+  uint32_t name_;
+  uint16_t track_;
+};
+
+inline std::string EscapeJSON(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+// Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+inline bool ExportChromeJSON(const std::string& path) {
+  Registry& registry = Registry::Get();
+  std::vector<std::string> names, tracks;
+  std::vector<Registry::ThreadEvents> threads = registry.Collect(names, tracks);
+  double ns_per_tick = registry.NsPerTick();
+  uint64_t base = registry.base_tsc();
+
+  std::ofstream out(path);
+  if (!out.is_open()) return false;
+  out << "{\"traceEvents\":[\n";
+  bool first = true;
+  for (auto& thread : threads) {
+    out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.tid
+        << ",\"args\":{\"name\":\"" << EscapeJSON(thread.name) << "\"}}";
+    first = false;
+    for (const Event& e : thread.events) {
+      static const char* kPhase[] = {"B", "E", "i"};
+      double ts_us = e.tsc > base ? (e.tsc - base) * ns_per_tick / 1000.0 : 0.0;
+      char ts[32];
+      std::snprintf(ts, sizeof(ts), "%.3f", ts_us);
+      out << ",\n{\"name\":\"" << EscapeJSON(names[e.name]) << "\",\"ph\":\"" << kPhase[static_cast<int>(e.phase)]
+          << "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << thread.tid;
+      if (e.phase == Phase::kInstant) out << ",\"s\":\"t\"";
+      out << ",\"args\":{\"track\":\"" << EscapeJSON(tracks[e.track]) << "\",\"value\":" << e.value << "}}";
+    }
+  }
+  out << "\n]}\n";
+  return true;
+}
+
+namespace proto {
+
+inline void Varint(std::string& out, uint64_t v) {
+  while (v >= 0x80) {
+    out += static_cast<char>((v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  out += static_cast<char>(v);
+}
+
+inline void Field(std::string& out, uint32_t field, uint64_t v) {
+  Varint(out, (static_cast<uint64_t>(field) << 3) | 0);
+  Varint(out, v);
+}
+
+inline void Bytes(std::string& out, uint32_t field, const std::string& bytes) {
+  Varint(out, (static_cast<uint64_t>(field) << 3) | 2);
+  Varint(out, bytes.size());
+  out += bytes;
+}
+
+}  // namespace proto
+
+// Perfetto protobuf trace (Trace.packet = TracePacket with TrackDescriptor /
+// TrackEvent), one track per traced thread.
+inline bool ExportPerfetto(const std::string& path) {
+  Registry& registry = Registry::Get();
+  std::vector<std::string> names, tracks;
+  std::vector<Registry::ThreadEvents> threads = registry.Collect(names, tracks);
+  double ns_per_tick = registry.NsPerTick();
+  uint64_t base = registry.base_tsc();
+
+  constexpr uint32_t kSequenceId = 1;
+  std::string trace;
+  for (auto& thread : threads) {
+    uint64_t track_uuid = 0x5e9000ULL + thread.tid;
+    std::string descriptor;
+    proto::Field(descriptor, 1, track_uuid);           // TrackDescriptor.uuid
+    proto::Bytes(descriptor, 2, thread.name);          // TrackDescriptor.name
+    std::string packet;
+    proto::Field(packet, 10, kSequenceId);             // TracePacket.trusted_packet_sequence_id
+    proto::Bytes(packet, 60, descriptor);              // TracePacket.track_descriptor
+    proto::Bytes(trace, 1, packet);                    // Trace.packet
+
+    for (const Event& e : thread.events) {
+      static const uint64_t kType[] = {1, 2, 3};       // SLICE_BEGIN, SLICE_END, INSTANT
+      std::string event;
+      proto::Field(event, 9, kType[static_cast<int>(e.phase)]);  // TrackEvent.type
+      proto::Field(event, 11, track_uuid);                       // TrackEvent.track_uuid
+      if (e.phase != Phase::kEnd) {
+        std::string name = names[e.name];
+        if (e.track != 0) name += " [" + tracks[e.track] + "]";
+        proto::Bytes(event, 23, name);                           // TrackEvent.name
+      }
+      std::string event_packet;
+      uint64_t ts_ns = e.tsc > base ? static_cast<uint64_t>((e.tsc - base) * ns_per_tick) : 0;
+      proto::Field(event_packet, 8, ts_ns);                      // TracePacket.timestamp
+      proto::Field(event_packet, 10, kSequenceId);
+      proto::Bytes(event_packet, 11, event);                     // TracePacket.track_event
+      proto::Bytes(trace, 1, event_packet);
+    }
+  }
+
+  std::ofstream out(path, std::ios::binary);
+  if (!out.is_open()) return false;
+  out.write(trace.data(), static_cast<std::streamsize>(trace.size()));
+  return true;
+}
+
+}  // namespace trace
+
+#define SEGMENT_TRACE_CONCAT_(a, b) a##b
+#define SEGMENT_TRACE_CONCAT(a, b) SEGMENT_TRACE_CONCAT_(a, b)
+
+#if SEGMENT_TRACE
+// `name` must be a string literal; it is interned on the first pass through the call site.
+#define SEGMENT_TRACE_INSTANT(name, track, value)                                        \
+  do {                                                                                   \
+    static const uint32_t _trace_name_id = ::trace::Registry::Get().InternName(name);    \
+    ::trace::ThisThreadRing().Push(_trace_name_id, (track), ::trace::Phase::kInstant, (value)); \
+  } while (0)
+#define SEGMENT_TRACE_SCOPE(name, track)                                                 \
+  static const uint32_t SEGMENT_TRACE_CONCAT(_trace_scope_id_, __LINE__) =               \
+      ::trace::Registry::Get().InternName(name);                                         \
+  ::trace::Scope SEGMENT_TRACE_CONCAT(_trace_scope_, __LINE__)(                          \
+      SEGMENT_TRACE_CONCAT(_trace_scope_id_, __LINE__), (track))
+#else
+#define SEGMENT_TRACE_INSTANT(name, track, value) ((void)(track))
+#define SEGMENT_TRACE_SCOPE(name, track) ((void)0)
+#endif
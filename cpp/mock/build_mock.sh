@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Build a SegmentRunner driver against the CPU mock engine (no GPU, model or
+# mlc-llm build needed), e.g.
+#   bash ../../cpp/mock/build_mock.sh 06_benchmark.cpp 06_benchmark_mock
+# Drivers that parse JSON also need picojson (PICOJSON_DIR).
+
+SRC=$1
+OUT=${2:-$(basename "$SRC" .cpp)_mock}
+MOCK_DIR=$(cd "$(dirname "$0")" && pwd)
+PICOJSON_DIR=${PICOJSON_DIR:-/home/rubis/workspace/mlc-llm-segment/3rdparty/xgrammar/3rdparty/picojson}
+
+g++ -std=c++20 -O2 \
+    -o $OUT $SRC \
+    -I$MOCK_DIR \
+    -I$MOCK_DIR/../common \
+    -I$PICOJSON_DIR \
+    -lpthread
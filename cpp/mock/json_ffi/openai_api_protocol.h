@@ -0,0 +1,15 @@
+#pragma once
+
+// Placeholders for the json_ffi types the SegmentRunner drivers alias but
+// do not use, so they build against the mock (see cpp/mock/build_mock.sh).
+
+namespace mlc {
+namespace llm {
+namespace json_ffi {
+
+struct ChatCompletionRequest {};
+struct ChatCompletionResponse {};
+
+}  // namespace json_ffi
+}  // namespace llm
+}  // namespace mlc
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "segment_log.h"
+
+// CPU-only stand-in for the threaded MLC engine.
+//
+// No model and no GPU: prompts are "tokenized" by length, tokens are drawn
+// from a small synthetic vocabulary and every prefill chunk and decode step
+// sleeps for the time given by a latency model with the same shape as
+// CostModel (see figure/fig_prefill_time and figure/fig_execute_time).
+// Queues, generators, schedulers and benchmarks run unchanged on any Linux
+// box; see serve/segment_runner/segment_runner.h in this directory for the
+// SegmentRunner drop-in.
+
+// Latency curves in microseconds.
+//   prefill chunk:  a + b * chunk + c * pos + d * chunk * pos
+//   decode step:    a + b * batch + c * batch * ctx_len
+// Every value gets uniform +-`jitter` relative noise; with probability
+// `spike_prob` a step takes `spike_factor` times longer (for WCET tests).
+struct MockLatencyModel {
+  std::array<double, 4> prefill_us = {3000.0, 25.0, 0.5, 0.01};
+  std::array<double, 3> decode_us = {7000.0, 150.0, 0.3};
+  double request_us = 300.0;  // admission (tokenization, request setup)
+  double ffi_us = 5.0;        // host-side query into the engine (e.g. KV cache page count)
+  double step_host_us = 0.0;  // host round trip of an engine step (action selection, sync, stream-back)
+  double jitter = 0.05;
+  double spike_prob = 0.0;
+  double spike_factor = 5.0;
+  double eos_prob = 0.0;      // per generated token
+  double chars_per_token = 4.0;
+  double time_scale = 1.0;    // multiplies every latency; 0 runs without sleeping
+
+  // Overrides from the environment, e.g.
+  //   MOCK_PREFILL_US=3000,25,0.5,0.01 MOCK_DECODE_US=7000,150,0.3
+  //   MOCK_REQUEST_US=300 MOCK_FFI_US=5 MOCK_STEP_HOST_US=0
+  //   MOCK_JITTER=0.05 MOCK_SPIKE=0.001,5
+  //   MOCK_EOS_PROB=0.01 MOCK_TIME_SCALE=0.1
+  static MockLatencyModel FromEnv() {
+    MockLatencyModel model;
+    ReadList("MOCK_PREFILL_US", model.prefill_us.data(), model.prefill_us.size());
+    ReadList("MOCK_DECODE_US", model.decode_us.data(), model.decode_us.size());
+    ReadList("MOCK_REQUEST_US", &model.request_us, 1);
+    ReadList("MOCK_FFI_US", &model.ffi_us, 1);
+    ReadList("MOCK_STEP_HOST_US", &model.step_host_us, 1);
+    ReadList("MOCK_JITTER", &model.jitter, 1);
+    double spike[2] = {model.spike_prob, model.spike_factor};
+    ReadList("MOCK_SPIKE", spike, 2);
+    model.spike_prob = spike[0];
+    model.spike_factor = spike[1];
+    ReadList("MOCK_EOS_PROB", &model.eos_prob, 1);
+    ReadList("MOCK_TIME_SCALE", &model.time_scale, 1);
+    return model;
+  }
+
+  double PrefillUs(int pos, int chunk, std::mt19937& rng) const {
+    const auto& p = prefill_us;
+    return Noise(p[0] + p[1] * chunk + p[2] * pos + p[3] * static_cast<double>(chunk) * pos, rng);
+  }
+
+  double DecodeUs(int ctx_len, int batch, std::mt19937& rng) const {
+    const auto& d = decode_us;
+    return Noise(d[0] + d[1] * batch + d[2] * static_cast<double>(batch) * ctx_len, rng);
+  }
+
+  double RequestUs(std::mt19937& rng) const { return Noise(request_us, rng); }
+
+  int NumPromptTokens(const std::string& prompt) const {
+    return std::max(1, static_cast<int>(prompt.size() / chars_per_token + 0.5));
+  }
+
+  void Sleep(double us) const {
+    if (time_scale <= 0.0 || us <= 0.0) return;
+    std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(us * time_scale));
+  }
+
+private:
+  double Noise(double us, std::mt19937& rng) const {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    double value = us * (1.0 + jitter * (2.0 * unit(rng) - 1.0));
+    if (spike_prob > 0.0 && unit(rng) < spike_prob) value *= spike_factor;
+    return std::max(0.0, value);
+  }
+
+  static void ReadList(const char* name, double* values, size_t n) {
+    const char* env = std::getenv(name);
+    if (env == nullptr) return;
+    std::stringstream ss(env);
+    std::string item;
+    for (size_t i = 0; i < n && std::getline(ss, item, ','); ++i) {
+      if (!item.empty()) values[i] = std::atof(item.c_str());
+    }
+  }
+};
+
+// Synthetic token ids and their text.
+struct MockVocab {
+  static int32_t Sample(std::mt19937& rng) { return static_cast<int32_t>(rng() % 32000); }
+  static std::string Text(int32_t id) {
+    static const char* kWords[] = {"the", "segment", "engine", "token", "runs", "on", "a", "mock",
+                                   "device", "and", "decodes", "every", "step", "in", "time", "."};
+    return std::string(" ") + kWords[id % 16];
+  }
+};
+
+// Same surface as the threaded engine module (init_threaded_engine, reload,
+// create_request, add_request, abort_request, run_background_loop,
+// run_background_stream_back_loop, exit_background_loop), with
+// std::function in place of the FFI callback. mock_ffi_module.h registers it
+// as an FFI module that CppInterface can load.
+struct MockEngineConfig {
+  int max_num_sequence = 4;    // running requests decoded as one batch
+  int prefill_chunk_size = 64;
+};
+
+struct MockRequest {
+  std::string id;
+  int num_prompt_tokens = 0;
+  int max_tokens = 256;
+};
+
+struct MockStreamOutput {
+  std::string request_id;
+  std::vector<int32_t> delta_token_ids;
+  std::optional<std::string> finish_reason;                 // "length", "stop" or "abort"
+  std::optional<std::string> request_final_usage_json_str;  // last output of a request
+};
+
+class MockThreadedEngine {
+public:
+  using StreamCallback = std::function<void(const std::vector<MockStreamOutput>&)>;
+
+  struct Stats {
+    uint64_t prefill_steps = 0;
+    uint64_t decode_steps = 0;
+    uint64_t tokens = 0;
+    uint64_t aborted = 0;
+    int max_batch = 0;
+  };
+
+  explicit MockThreadedEngine(MockLatencyModel model = MockLatencyModel::FromEnv(), uint32_t seed = 4542)
+      : model_(model), rng_(seed) {}
+
+  // init_threaded_engine
+  void InitThreadedEngine(StreamCallback request_stream_callback) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    callback_ = std::move(request_stream_callback);
+  }
+
+  // reload
+  void Reload(const MockEngineConfig& config) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    config_ = config;
+    config_.max_num_sequence = std::max(1, config_.max_num_sequence);
+    config_.prefill_chunk_size = std::max(1, config_.prefill_chunk_size);
+  }
+
+  MockEngineConfig GetCompleteEngineConfig() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return config_;
+  }
+
+  // create_request
+  MockRequest CreateRequest(const std::string& request_id, const std::string& prompt, int max_tokens) const {
+    return MockRequest{request_id, model_.NumPromptTokens(prompt), max_tokens};
+  }
+
+  // add_request
+  void AddRequest(const MockRequest& request) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      waiting_.push_back(Running{request});
+    }
+    engine_cv_.notify_one();
+  }
+
+  // abort_request: the request ends with finish reason "abort" at the next
+  // step boundary.
+  void AbortRequest(const std::string& request_id) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      aborts_.push_back(request_id);
+    }
+    engine_cv_.notify_one();
+  }
+
+  // run_background_loop: admit, then one prefill chunk of the oldest
+  // prefilling request or one decode step of the whole batch, until exit.
+  void RunBackgroundLoop() {
+    while (true) {
+      std::vector<MockStreamOutput> outputs;
+      double step_us = 0.0;
+      {
+        std::unique_lock<std::mutex> lock(mtx_);
+        engine_cv_.wait(lock, [this] { return exit_ || !waiting_.empty() || !running_.empty() || !aborts_.empty(); });
+        if (exit_) break;
+        ApplyAborts(outputs);
+        while (!waiting_.empty() && static_cast<int>(running_.size()) < config_.max_num_sequence) {
+          running_.push_back(waiting_.front());
+          waiting_.pop_front();
+        }
+        stats_.max_batch = std::max(stats_.max_batch, static_cast<int>(running_.size()));
+        step_us = Step(outputs);
+      }
+      // The step "runs on the device" outside the lock, so add/abort do not block.
+      model_.Sleep(step_us);
+      if (!outputs.empty()) PushOutputs(std::move(outputs));
+    }
+    {
+      std::lock_guard<std::mutex> lock(stream_mtx_);
+      stream_exit_ = true;
+    }
+    stream_cv_.notify_all();
+  }
+
+  // run_background_stream_back_loop: hands the outputs of every step to the
+  // callback, in step order.
+  void RunBackgroundStreamBackLoop() {
+    while (true) {
+      std::vector<MockStreamOutput> outputs;
+      {
+        std::unique_lock<std::mutex> lock(stream_mtx_);
+        stream_cv_.wait(lock, [this] { return stream_exit_ || !stream_queue_.empty(); });
+        if (stream_queue_.empty()) return;
+        outputs = std::move(stream_queue_.front());
+        stream_queue_.pop_front();
+      }
+      StreamCallback callback;
+      {
+        std::lock_guard<std::mutex> lock(mtx_);
+        callback = callback_;
+      }
+      if (callback) callback(outputs);
+    }
+  }
+
+  // exit_background_loop
+  void ExitBackgroundLoop() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      exit_ = true;
+    }
+    engine_cv_.notify_all();
+  }
+
+  Stats stats() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+  }
+
+private:
+  struct Running {
+    MockRequest request;
+    int prefilled = 0;
+    int generated = 0;
+  };
+
+  // Called with mtx_ held; returns the simulated duration of the step.
+  double Step(std::vector<MockStreamOutput>& outputs) {
+    if (running_.empty()) return 0.0;
+    for (Running& r : running_) {
+      if (r.prefilled >= r.request.num_prompt_tokens) continue;
+      int chunk = std::min(config_.prefill_chunk_size, r.request.num_prompt_tokens - r.prefilled);
+      double us = (r.prefilled == 0 ? model_.RequestUs(rng_) : 0.0) + model_.PrefillUs(r.prefilled, chunk, rng_);
+      r.prefilled += chunk;
+      stats_.prefill_steps++;
+      SEGMENT_LOG_DEBUG("prefill chunk {} tokens, {}/{} prefilled, {}us", chunk, r.prefilled,
+                        r.request.num_prompt_tokens, us);
+      return us;
+    }
+
+    int batch = static_cast<int>(running_.size());
+    int max_ctx = 0;
+    std::vector<Running> still_running;
+    for (Running& r : running_) {
+      max_ctx = std::max(max_ctx, r.request.num_prompt_tokens + r.generated);
+      MockStreamOutput output;
+      output.request_id = r.request.id;
+      output.delta_token_ids.push_back(MockVocab::Sample(rng_));
+      r.generated++;
+      stats_.tokens++;
+      std::uniform_real_distribution<double> unit(0.0, 1.0);
+      if (model_.eos_prob > 0.0 && unit(rng_) < model_.eos_prob) output.finish_reason = "stop";
+      else if (r.generated >= r.request.max_tokens) output.finish_reason = "length";
+      outputs.push_back(output);
+      if (output.finish_reason.has_value()) outputs.push_back(FinalUsage(r));
+      else still_running.push_back(r);
+    }
+    running_ = std::move(still_running);
+    stats_.decode_steps++;
+    double us = model_.DecodeUs(max_ctx, batch, rng_);
+    SEGMENT_LOG_DEBUG("decode batch {} max context {} finished {} waiting {}, {}us", batch, max_ctx,
+                      batch - static_cast<int>(running_.size()), waiting_.size(), us);
+    return us;
+  }
+
+  void ApplyAborts(std::vector<MockStreamOutput>& outputs) {
+    for (const std::string& id : aborts_) {
+      auto abort_in = [&](auto& requests) {
+        for (auto it = requests.begin(); it != requests.end(); ++it) {
+          if (it->request.id != id) continue;
+          MockStreamOutput output;
+          output.request_id = id;
+          output.finish_reason = "abort";
+          outputs.push_back(output);
+          outputs.push_back(FinalUsage(*it));
+          requests.erase(it);
+          stats_.aborted++;
+          return true;
+        }
+        return false;
+      };
+      if (!abort_in(running_)) abort_in(waiting_);
+    }
+    aborts_.clear();
+  }
+
+  static MockStreamOutput FinalUsage(const Running& r) {
+    MockStreamOutput output;
+    output.request_id = r.request.id;
+    output.request_final_usage_json_str = "{\"prompt_tokens\": " + std::to_string(r.request.num_prompt_tokens) +
+                                          ", \"completion_tokens\": " + std::to_string(r.generated) + "}";
+    return output;
+  }
+
+  void PushOutputs(std::vector<MockStreamOutput> outputs) {
+    {
+      std::lock_guard<std::mutex> lock(stream_mtx_);
+      stream_queue_.push_back(std::move(outputs));
+    }
+    stream_cv_.notify_one();
+  }
+
+  MockLatencyModel model_;
+  std::mt19937 rng_;
+  MockEngineConfig config_;
+  StreamCallback callback_;
+  Stats stats_;
+
+  std::mutex mtx_;
+  std::condition_variable engine_cv_;
+  std::deque<Running> waiting_;
+  std::vector<Running> running_;
+  std::vector<std::string> aborts_;
+  bool exit_ = false;
+
+  std::mutex stream_mtx_;
+  std::condition_variable stream_cv_;
+  std::deque<std::vector<MockStreamOutput>> stream_queue_;
+  bool stream_exit_ = false;
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+// MockThreadedEngine (mock_engine.h) as a threaded engine FFI module.
+//
+// CppInterface reaches the engine only through the functions of the module
+// made by a global factory (init_threaded_engine, reload,
+// get_complete_engine_config, create_request, add_request, abort_request,
+// run_background_loop, run_background_stream_back_loop,
+// exit_background_loop). RegisterMockThreadedEngine() registers
+// kMockThreadedEngineFactory, whose module serves those functions from the
+// mock, so the whole interface (tokenizer, request setup, stream-back,
+// detokenize) runs without a GPU or a model library:
+//
+//   RegisterMockThreadedEngine();
+//   cpp_interface.set_engine_factory(kMockThreadedEngineFactory);
+//   cpp_interface.init(model_dir, ...);  // still reads the model's config and tokenizer
+//
+// Unlike the SegmentRunner drop-in this header is built against the real
+// tvm / mlc-llm headers and libraries: requests and stream outputs are the
+// engine's own objects. Include it by path, not through -I cpp/mock, which
+// would shadow the real json_ffi and tokenizers headers.
+//
+// Opt-in: 01_cpp_interface_prototype includes it only when built with
+// -DMOCK_ENGINE, so the default build never compiles it.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <picojson.h>
+#include <serve/config.h>
+#include <serve/data.h>
+#include <serve/request.h>
+#include <serve/threaded_engine.h>
+#include <tvm/ffi/function.h>
+#include <tvm/ffi/optional.h>
+#include <tvm/ffi/string.h>
+#include <tvm/runtime/module.h>
+
+#include "mock_engine.h"
+
+inline constexpr const char* kMockThreadedEngineFactory = "mlc.serve.create_mock_threaded_engine";
+
+class MockThreadedEngineModule : public tvm::runtime::ModuleNode {
+public:
+  const char* type_key() const final { return "mlc.serve.mock_threaded_engine"; }
+
+  tvm::ffi::Function GetFunction(const tvm::ffi::String& name,
+                                 const tvm::ffi::ObjectPtr<tvm::ffi::Object>& sptr_to_self) final {
+    using tvm::ffi::Any;
+    using tvm::ffi::Function;
+    using tvm::ffi::PackedArgs;
+    // Every function keeps the module alive while it is held.
+    auto bind = [sptr_to_self](auto body) {
+      return Function::FromPacked([sptr_to_self, body](PackedArgs args, Any* rv) { body(args, rv); });
+    };
+    if (name == "init_threaded_engine") {
+      // (device, request_stream_callback, trace_recorder); device and recorder are unused.
+      return bind([this](PackedArgs args, Any*) {
+        auto callback = args[1].cast<tvm::ffi::Optional<Function>>();
+        engine_.InitThreadedEngine([callback](const std::vector<MockStreamOutput>& outputs) {
+          if (!callback.has_value()) return;
+          tvm::ffi::Array<mlc::llm::serve::RequestStreamOutput> delta_outputs;
+          for (const MockStreamOutput& output : outputs) delta_outputs.push_back(ToStreamOutput(output));
+          callback.value()(delta_outputs);
+        });
+      });
+    }
+    if (name == "reload") {
+      return bind([this](PackedArgs args, Any*) { Reload(args[0].cast<std::string>()); });
+    }
+    if (name == "get_complete_engine_config") {
+      return bind([this](PackedArgs, Any* rv) { *rv = tvm::ffi::String(engine_config_json_); });
+    }
+    if (name == "create_request") {
+      // (request_id, inputs, generation_cfg_json_str), as the engine's create_request.
+      return bind([](PackedArgs args, Any* rv) {
+        *rv = CreateRequest(args[0].cast<tvm::ffi::String>(),
+                            args[1].cast<tvm::ffi::Array<mlc::llm::serve::Data>>(),
+                            args[2].cast<std::string>());
+      });
+    }
+    if (name == "add_request") {
+      return bind([this](PackedArgs args, Any*) {
+        auto request = args[0].cast<mlc::llm::serve::Request>();
+        int num_prompt_tokens = 0;
+        for (const mlc::llm::serve::Data& data : request->inputs) num_prompt_tokens += data->GetLength();
+        int max_tokens = request->generation_cfg->max_tokens;
+        engine_.AddRequest(MockRequest{request->id, num_prompt_tokens, max_tokens > 0 ? max_tokens : 256});
+      });
+    }
+    if (name == "abort_request") {
+      return bind([this](PackedArgs args, Any*) {
+        if (args.size() > 0) engine_.AbortRequest(args[0].cast<std::string>());
+      });
+    }
+    if (name == "run_background_loop") {
+      return bind([this](PackedArgs, Any*) { engine_.RunBackgroundLoop(); });
+    }
+    if (name == "run_background_stream_back_loop") {
+      return bind([this](PackedArgs, Any*) { engine_.RunBackgroundStreamBackLoop(); });
+    }
+    if (name == "exit_background_loop") {
+      return bind([this](PackedArgs, Any*) { engine_.ExitBackgroundLoop(); });
+    }
+    return Function();
+  }
+
+private:
+  // Takes max_num_sequence and prefill_chunk_size from the engine config and
+  // reports them back as the complete config.
+  void Reload(const std::string& engine_config_json) {
+    picojson::value v;
+    std::string err = picojson::parse(v, engine_config_json);
+    MockEngineConfig config;
+    if (err.empty() && v.is<picojson::object>()) {
+      picojson::object& obj = v.get<picojson::object>();
+      auto read = [&obj](const char* key, int& value) {
+        if (obj.count(key) && obj.at(key).is<double>() && obj.at(key).get<double>() > 0) {
+          value = static_cast<int>(obj.at(key).get<double>());
+        }
+      };
+      read("max_num_sequence", config.max_num_sequence);
+      read("prefill_chunk_size", config.prefill_chunk_size);
+      obj["max_num_sequence"] = picojson::value(static_cast<double>(config.max_num_sequence));
+      obj["prefill_chunk_size"] = picojson::value(static_cast<double>(config.prefill_chunk_size));
+    }
+    engine_.Reload(config);
+    engine_config_json_ = v.serialize();
+  }
+
+  static mlc::llm::serve::Request CreateRequest(tvm::ffi::String request_id,
+                                                tvm::ffi::Array<mlc::llm::serve::Data> inputs,
+                                                const std::string& generation_cfg_json) {
+    auto generation_config_node = tvm::ffi::make_object<mlc::llm::serve::GenerationConfigNode>();
+    picojson::value v;
+    std::string err = picojson::parse(v, generation_cfg_json);
+    if (err.empty() && v.is<picojson::object>()) {
+      const picojson::object& obj = v.get<picojson::object>();
+      if (obj.count("n") && obj.at("n").is<double>()) generation_config_node->n = static_cast<int>(obj.at("n").get<double>());
+      if (obj.count("max_tokens") && obj.at("max_tokens").is<double>()) {
+        generation_config_node->max_tokens = static_cast<int>(obj.at("max_tokens").get<double>());
+      }
+    }
+    return mlc::llm::serve::Request(request_id, inputs, mlc::llm::serve::GenerationConfig(generation_config_node));
+  }
+
+  static mlc::llm::serve::RequestStreamOutput ToStreamOutput(const MockStreamOutput& output) {
+    if (output.request_final_usage_json_str.has_value()) {
+      return mlc::llm::serve::RequestStreamOutput::Usage(output.request_id, output.request_final_usage_json_str.value());
+    }
+    std::vector<int64_t> delta_token_ids(output.delta_token_ids.begin(), output.delta_token_ids.end());
+    tvm::ffi::Optional<tvm::ffi::String> finish_reason;
+    if (output.finish_reason.has_value()) finish_reason = tvm::ffi::String(output.finish_reason.value());
+    return mlc::llm::serve::RequestStreamOutput(output.request_id, {delta_token_ids}, std::nullopt, {finish_reason},
+                                                {tvm::ffi::String("")});
+  }
+
+  MockThreadedEngine engine_;
+  std::string engine_config_json_ = "{}";
+};
+
+// Registers kMockThreadedEngineFactory; safe to call more than once.
+inline void RegisterMockThreadedEngine() {
+  tvm::ffi::Function::SetGlobal(
+      kMockThreadedEngineFactory,
+      tvm::ffi::Function::FromPacked([](tvm::ffi::PackedArgs, tvm::ffi::Any* rv) {
+        *rv = tvm::runtime::Module(tvm::ffi::make_object<MockThreadedEngineModule>());
+      }),
+      /*override=*/true);
+}
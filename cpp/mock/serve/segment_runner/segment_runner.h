@@ -0,0 +1,170 @@
+#pragma once
+
+// Drop-in SegmentRunner backed by MockLatencyModel (../../mock_engine.h).
+//
+// Build a driver against the mock instead of the mlc-llm fork by putting
+// cpp/mock first on the include path (see cpp/mock/build_mock.sh). The
+// model directory, library and device are ignored; the latency model is
+// read from the MOCK_* environment variables at Init(). Steps report the
+// engine's actions and packed functions to segment_timeline.h and their
+// packed-function calls to step_counters.h. The split of a step over its
+// functions is a fixed fraction of the modelled step time, so the timeline
+// table only checks the report itself; it says nothing about the real engine.
+//
+// Steps follow the engine's action sequence: every action runs and queries
+// the available KV pages. The per-step call counts therefore only restate
+// that sequence; they are not a measurement of the engine.
+//
+// Every engine step pays MOCK_STEP_HOST_US on the host (action selection,
+// sampling sync, stream-back, detokenize).
+
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+// Pulled in by the real header; some drivers rely on it.
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "../../mock_engine.h"
+#include "segment_timeline.h"
+#include "step_counters.h"
+
+// Minimal DLPack / TVM names the drivers use with the real headers.
+#ifndef DLPACK_VERSION
+typedef enum {
+  kDLCPU = 1,
+  kDLCUDA = 2,
+  kDLOpenCL = 4,
+  kDLVulkan = 7,
+  kDLMetal = 8,
+  kDLROCM = 10,
+} DLDeviceType;
+
+typedef struct {
+  DLDeviceType device_type;
+  int32_t device_id;
+} DLDevice;
+
+namespace tvm {
+using Device = DLDevice;
+namespace ffi {}
+}  // namespace tvm
+#endif
+
+// One packed-function call taking `us` on the (mock) device.
+#define MOCK_FUNC_(name, us)         \
+  do {                               \
+    SEGMENT_TIMELINE_FUNC(name);     \
+    SEGMENT_FFI_CALL(name);          \
+    model_.Sleep(us);                \
+  } while (0)
+
+class SegmentRunner {
+public:
+  void Init(std::string model_dir, tvm::Device device, std::string model_lib, std::string mode,
+            int prefill_chunk_size) {
+    model_ = MockLatencyModel::FromEnv();
+    timeline::Recorder::Get().SetNote("mock engine: function times are fixed fractions of the modelled step, not measurements");
+    chunk_ = std::max(1, prefill_chunk_size);
+  }
+
+  void SetSeed(int seed) { rng_.seed(static_cast<uint32_t>(seed)); }
+
+  // Admission plus the first prefill chunk, like the engine's Request.
+  void Request(std::string prompt, int max_tokens) {
+    if (num_prompt_tokens_ + generated_ > 0) RemoveSequence();
+    num_prompt_tokens_ = model_.NumPromptTokens(prompt);
+    max_tokens_ = max_tokens;
+    prefilled_ = 0;
+    generated_ = 0;
+    stopped_ = false;
+    MOCK_FUNC_("kv_cache_add_sequence_func_", model_.RequestUs(rng_));
+    Prefill(1);
+  }
+
+  void Prefill(int n) {
+    for (int i = 0; i < n && !IsPrefillEnd(); ++i) {
+      HostRoundTrip();
+      {
+        SEGMENT_TIMELINE_ACTION("NewRequestPrefill");
+        QueryAvailablePages();
+        QueryAvailablePages();  // the engine checks twice before admitting
+        int chunk = std::min(chunk_, num_prompt_tokens_ - prefilled_);
+        double us = model_.PrefillUs(prefilled_, chunk, rng_);
+        MOCK_FUNC_("embed_func_", us * 0.03);
+        MOCK_FUNC_("single_batch_prefill_func_", us * 0.90);
+        MOCK_FUNC_("softmax_func_", us * 0.04);
+        MOCK_FUNC_("gpu_multinomial_from_uniform_func_", us * 0.03);
+        prefilled_ += chunk;
+      }
+      StepCallCounter::Get().EndStep();
+    }
+  }
+
+  bool IsPrefillEnd() { return prefilled_ >= num_prompt_tokens_; }
+
+  std::string Execute(int n) {
+    if (!IsPrefillEnd()) Prefill(num_prompt_tokens_);
+    std::vector<int32_t> token_ids;
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (int i = 0; i < n && !IsEnd(); ++i) {
+      HostRoundTrip();
+      {
+        SEGMENT_TIMELINE_ACTION("NewRequestPrefill");
+        QueryAvailablePages();
+      }
+      {
+        SEGMENT_TIMELINE_ACTION("Batch jump forward");
+        QueryAvailablePages();
+      }
+      {
+        SEGMENT_TIMELINE_ACTION("Batch decode");
+        QueryAvailablePages();
+        double us = model_.DecodeUs(num_prompt_tokens_ + generated_, 1, rng_);
+        MOCK_FUNC_("embed_func_", us * 0.03);
+        MOCK_FUNC_("single_batch_decode_func_", us * 0.85);
+        MOCK_FUNC_("softmax_func_", us * 0.07);
+        MOCK_FUNC_("gpu_multinomial_from_uniform_func_", us * 0.05);
+      }
+      token_ids.push_back(MockVocab::Sample(rng_));
+      generated_++;
+      if (model_.eos_prob > 0.0 && unit(rng_) < model_.eos_prob) stopped_ = true;
+      StepCallCounter::Get().EndStep();
+    }
+    std::string delta;
+    for (int32_t id : token_ids) delta += MockVocab::Text(id);
+    return delta;
+  }
+
+  bool IsEnd() { return stopped_ || generated_ >= max_tokens_; }
+
+private:
+  static constexpr int64_t kNumPages = 8192;
+  static constexpr int kPageSize = 16;
+
+  int64_t QueryAvailablePages() {
+    MOCK_FUNC_("kv_cache_get_num_available_pages_func_", model_.ffi_us);
+    return kNumPages - (prefilled_ + generated_ + kPageSize - 1) / kPageSize;
+  }
+
+  void HostRoundTrip() {
+    SEGMENT_TIMELINE_ACTION("Host round trip");
+    model_.Sleep(model_.step_host_us);
+  }
+
+  void RemoveSequence() {
+    MOCK_FUNC_("kv_cache_remove_sequence_func_", 0.0);
+  }
+
+  MockLatencyModel model_;
+  std::mt19937 rng_{4542};
+  int chunk_ = 64;
+  int num_prompt_tokens_ = 0;
+  int max_tokens_ = 0;
+  int prefilled_ = 0;
+  int generated_ = 0;
+  bool stopped_ = false;
+};
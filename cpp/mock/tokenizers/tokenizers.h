@@ -0,0 +1,41 @@
+#pragma once
+
+// Stand-in for mlc::llm::Tokenizer with the same call surface the drivers
+// use (Tokenizer::FromPath, tokenizer->Encode), so they build against the
+// mock (see cpp/mock/build_mock.sh). Encode returns as many tokens as the
+// mock engine charges for the text (MockLatencyModel::NumPromptTokens).
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../mock_engine.h"
+
+namespace mlc {
+namespace llm {
+
+class TokenizerObj {
+public:
+  std::vector<int32_t> Encode(const std::string& text) const {
+    std::vector<int32_t> ids(model_.NumPromptTokens(text));
+    for (size_t i = 0; i < ids.size(); ++i) ids[i] = static_cast<int32_t>(i % 32000);
+    return ids;
+  }
+
+private:
+  MockLatencyModel model_ = MockLatencyModel::FromEnv();
+};
+
+class Tokenizer {
+public:
+  static Tokenizer FromPath(const std::string&) { return Tokenizer(std::make_shared<TokenizerObj>()); }
+  const TokenizerObj* operator->() const { return obj_.get(); }
+
+private:
+  explicit Tokenizer(std::shared_ptr<TokenizerObj> obj) : obj_(std::move(obj)) {}
+  std::shared_ptr<TokenizerObj> obj_;
+};
+
+}  // namespace llm
+}  // namespace mlc
@@ -46,6 +46,9 @@
 #include <serve/segment_runner/generator.h>
 #include <serve/segment_runner/cpp_interface.h>
 
+#include "latency_histogram.h"
+#include "model_paths.h"
+
 using namespace tvm;
 using namespace ffi;
 
@@ -53,12 +56,13 @@ using ChatCompletionRequest = mlc::llm::json_ffi::ChatCompletionRequest;
 using ChatCompletionResponse = mlc::llm::json_ffi::ChatCompletionResponse;
 
 int main(int argc, char* argv[]){
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace");
   int max_tokens_value = -1;
   if(argc > 1)
     max_tokens_value = atoi(argv[1]);
 
-  std::string model_dir = "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace";
-  std::string model_lib_path = model_dir + "/llama-3.2-1b-cuda.so";
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
   tvm::Device dev{kDLCUDA, 0};
   std::string mode = "local";
 
@@ -72,10 +76,9 @@ int main(int argc, char* argv[]){
 
   std::string prompt("Why USA is the one of the strongest country?");
   
-  std::vector<std::chrono::duration<float>> total_time_list;
-
   int n = 1;
   int warmup = 2;
+  LatencyRecorder latency(warmup);
   int max_tokens = 256;
   if(max_tokens_value > 0) max_tokens = max_tokens_value;
   
@@ -85,26 +88,20 @@ int main(int argc, char* argv[]){
 
   for(int i = 0; i < n + warmup; i++){
     printf("instance %d\n", i);   
+    latency.StartIteration(i);
     
     auto total_start = std::chrono::high_resolution_clock::now();
     
     ChatCompletionResponse response = cpp_interface.create(request_id, request);
     auto total_end = std::chrono::high_resolution_clock::now();
     
-    total_time_list.push_back(total_end - total_start);
+    latency.Record("total", total_end - total_start);
 
     std::cout<<"==============================="<<std::endl;    
     std::cout<<""<<cpp_interface.response_to_str(response)<<std::endl;
   }
 
-  total_time_list.erase(total_time_list.begin(), total_time_list.begin()+warmup);
-  float total_time_avg = mlc::llm::utils::calculate_duration_avg(total_time_list) * 1000;
-  float total_time_max = mlc::llm::utils::calculate_duration_max(total_time_list) * 1000;
-
-  std::cout << "===========================" << std::endl;
-  std::cout << "# total time" << std::endl;
-  std::cout << "Average response time: " << total_time_avg << "ms" << std::endl;
-  std::cout << "Worst response time: " << total_time_max << "ms" << std::endl;
+  latency.Print(std::cout);
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <tokenizers/tokenizers.h>
+
+#include "tokenizer_service.h"
+#include "model_paths.h"
+
+std::string readFileToString(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("파일을 열 수 없습니다: " + filePath);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();  // 전체 파일 내용을 스트림으로 읽기
+    return buffer.str();     // 문자열로 반환
+}
+
+// Usage: ./04_tokenizer_service input_length_44.txt input_length_399.txt ...
+int main(int argc, char* argv[]){
+  std::string model_dir = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b").model_dir;
+
+  std::vector<std::string> corpus;
+  for(int i = 1; i < argc; i++){
+    corpus.push_back(readFileToString(argv[i]));
+  }
+  if(corpus.empty()){
+    std::cout << "[ERROR] No input files" << std::endl;
+    return 0;
+  }
+
+  std::vector<int> thread_counts = {1, 4, 16};
+  int n = 5;
+  int warmup = 1;
+
+  for(int num_threads : thread_counts){
+    TokenizerService service([&model_dir](int){
+      mlc::llm::Tokenizer tokenizer = mlc::llm::Tokenizer::FromPath(model_dir);
+      return [tokenizer](const std::string& text){ return tokenizer->Encode(text); };
+    }, num_threads, corpus.size());
+
+    float cold_time = 0.0f;
+    float warm_time = 0.0f;
+    size_t num_tokens = 0;
+
+    for(int i = 0; i < n + warmup; i++){
+      // - Cold: every document is encoded by the pool
+      service.ClearCache();
+      auto s = std::chrono::high_resolution_clock::now();
+      auto outputs = service.EncodeBatch(corpus);
+      auto e = std::chrono::high_resolution_clock::now();
+
+      // - Warm: the same documents again, served from the cache
+      auto ws = std::chrono::high_resolution_clock::now();
+      service.EncodeBatch(corpus);
+      auto we = std::chrono::high_resolution_clock::now();
+
+      if(i < warmup) continue;
+      cold_time += std::chrono::duration<float>(e - s).count();
+      warm_time += std::chrono::duration<float>(we - ws).count();
+      num_tokens = 0;
+      for(auto& tokens : outputs) num_tokens += tokens.size();
+    }
+
+    float docs = static_cast<float>(corpus.size()) * n;
+    std::cout << "===========================" << std::endl;
+    std::cout << "# threads: " << num_threads << std::endl;
+    std::cout << "documents: " << corpus.size() << " / tokens: " << num_tokens << std::endl;
+    std::cout << "cold: " << docs / cold_time << " docs/s, " << num_tokens * n / cold_time << " tokens/s" << std::endl;
+    std::cout << "warm: " << docs / warm_time << " docs/s, " << num_tokens * n / warm_time << " tokens/s" << std::endl;
+    TokenizerService::Stats stats = service.GetStats();
+    std::cout << "cache hits: " << stats.hits << " / misses: " << stats.misses << std::endl;
+  }
+
+  return 0;
+}
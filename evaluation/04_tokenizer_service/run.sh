@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# Encode the input_length_*.txt corpus with 1, 4 and 16 tokenization threads
+./04_tokenizer_service ../../figure/fig_execute_time/input_length_*.txt > output.txt
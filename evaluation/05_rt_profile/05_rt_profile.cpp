@@ -0,0 +1,82 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <serve/segment_runner/segment_runner.h>
+
+#include "latency_histogram.h"
+#include "rt_profile.h"
+#include "model_paths.h"
+
+using namespace tvm;
+using namespace ffi;
+
+std::string readFileToString(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("파일을 열 수 없습니다: " + filePath);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();  // 전체 파일 내용을 스트림으로 읽기
+    return buffer.str();     // 문자열로 반환
+}
+
+int main(int argc, char* argv[]){
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
+  tvm::Device dev{kDLCUDA, 0};
+  std::string mode = "local";
+  int prefill_chunk_size = 64;
+  int max_tokens = 512;
+  int n = 10;
+  int warmup = 1;
+
+  // ./05_rt_profile [default|rt] [cpu] [fifo priority]
+  // Local SegmentRunner: segments run on the calling thread, so only the caller
+  // settings apply. The engine loop and stream-back threads are profiled through
+  // CppInterface: cpp/01_cpp_interface_prototype profile [default|rt] (see run.sh)
+  RtProfile rt_profile;
+  if(argc > 1 && std::string(argv[1]) == "rt"){
+    rt_profile.enabled = true;
+    rt_profile.caller.cpu = argc > 2 ? atoi(argv[2]) : 2;
+    rt_profile.caller.fifo_priority = argc > 3 ? atoi(argv[3]) : 80;
+  }
+  rt::ApplyProcess(rt_profile);
+
+  SegmentRunner segment_runner;
+  segment_runner.Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
+  segment_runner.SetSeed(4542); // For same experiment
+  std::string prompt = readFileToString("../02_cpp_segment_runner/input.txt");
+
+  LatencyRecorder latency(warmup);
+  for(int i = 0; i < n + warmup; i++){
+    latency.StartIteration(i);
+    segment_runner.Request(prompt, max_tokens);
+    while(!segment_runner.IsPrefillEnd()){
+      auto s = std::chrono::high_resolution_clock::now();
+      segment_runner.Prefill(1);
+      auto e = std::chrono::high_resolution_clock::now();
+      latency.Record("prefill segment", e - s);
+    }
+    while(!segment_runner.IsEnd()){
+      auto s = std::chrono::high_resolution_clock::now();
+      segment_runner.Execute(1);
+      auto e = std::chrono::high_resolution_clock::now();
+      latency.Record("execute segment", e - s);
+    }
+  }
+
+  std::cout << "===========================" << std::endl;
+  std::cout << "profile: " << (rt_profile.enabled ? "rt" : "default") << std::endl;
+  latency.Print(std::cout);
+
+  return 0;
+}
@@ -0,0 +1,10 @@
+#!/bin/bash
+
+# Segment latency without and with the real-time profile (pinning, SCHED_FIFO, mlockall)
+./05_rt_profile default > output_default.txt
+sudo ./05_rt_profile rt 2 80 > output_rt.txt
+
+# Through CppInterface: engine loop (CPU 2, FIFO 80), stream back (CPU 3, FIFO 70), caller (CPU 4, FIFO 60)
+cd ../../cpp/01_cpp_interface_prototype
+./01_cpp_interface_prototype profile default > ../../evaluation/05_rt_profile/output_interface_default.txt
+sudo ./01_cpp_interface_prototype profile rt > ../../evaluation/05_rt_profile/output_interface_rt.txt
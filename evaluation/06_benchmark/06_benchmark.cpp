@@ -0,0 +1,301 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <utility>
+
+#include <unistd.h>
+
+#include <picojson.h>
+
+#include <serve/segment_runner/segment_runner.h>
+
+#include "latency_histogram.h"
+#include "model_paths.h"
+
+using namespace tvm;
+using namespace ffi;
+
+#ifndef BENCH_GIT_COMMIT
+#define BENCH_GIT_COMMIT "unknown"
+#endif
+
+std::string readFileToString(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("파일을 열 수 없습니다: " + filePath);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();  // 전체 파일 내용을 스트림으로 읽기
+    return buffer.str();     // 문자열로 반환
+}
+
+std::vector<std::string> split(const std::string& s, char delim){
+  std::vector<std::string> items;
+  std::stringstream ss(s);
+  std::string item;
+  while(std::getline(ss, item, delim)){
+    if(!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+std::vector<int> splitInt(const std::string& s){
+  std::vector<int> values;
+  for(const std::string& item : split(s, ',')) values.push_back(atoi(item.c_str()));
+  return values;
+}
+
+bool parseDevice(const std::string& name, tvm::Device& dev){
+  std::vector<std::string> parts = split(name, ':');
+  if(parts.empty()) return false;
+  int id = parts.size() > 1 ? atoi(parts[1].c_str()) : 0;
+  if(parts[0] == "cuda") dev = tvm::Device{kDLCUDA, id};
+  else if(parts[0] == "rocm") dev = tvm::Device{kDLROCM, id};
+  else if(parts[0] == "vulkan") dev = tvm::Device{kDLVulkan, id};
+  else if(parts[0] == "metal") dev = tvm::Device{kDLMetal, id};
+  else if(parts[0] == "cpu") dev = tvm::Device{kDLCPU, id};
+  else return false;
+  return true;
+}
+
+std::string timestamp(){
+  std::time_t now = std::time(nullptr);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+  return buf;
+}
+
+std::string hostname(){
+  char buf[256] = {0};
+  gethostname(buf, sizeof(buf) - 1);
+  return buf;
+}
+
+// One result row; columns keep insertion order for the CSV header.
+using Row = std::vector<std::pair<std::string, picojson::value>>;
+
+void addStats(Row& row, const std::string& type, const LatencyHistogram& h){
+  std::string prefix = type;
+  for(char& c : prefix) if(c == ' ') c = '_';
+  auto ms = [](double ns){ return picojson::value(ns / 1e6); };
+  row.emplace_back(prefix + "_count", picojson::value(static_cast<double>(h.count())));
+  row.emplace_back(prefix + "_mean_ms", ms(h.mean()));
+  row.emplace_back(prefix + "_stddev_ms", ms(h.stddev()));
+  row.emplace_back(prefix + "_p50_ms", ms(static_cast<double>(h.Percentile(50.0))));
+  row.emplace_back(prefix + "_p99_ms", ms(static_cast<double>(h.Percentile(99.0))));
+  row.emplace_back(prefix + "_p999_ms", ms(static_cast<double>(h.Percentile(99.9))));
+  row.emplace_back(prefix + "_max_ms", ms(static_cast<double>(h.max())));
+  row.emplace_back(prefix + "_pwcet_ms", ms(h.GumbelWcet()));
+}
+
+std::string csvField(const picojson::value& v){
+  std::string s = v.is<std::string>() ? v.get<std::string>() : v.serialize();
+  if(s.find_first_of(",\"\n") == std::string::npos) return s;
+  std::string quoted = "\"";
+  for(char c : s){
+    if(c == '"') quoted += '"';
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+void writeRow(std::ostream& out, const Row& row, const std::string& format, bool header){
+  if(format == "csv"){
+    if(header){
+      for(size_t i = 0; i < row.size(); i++) out << (i ? "," : "") << row[i].first;
+      out << "\n";
+    }
+    for(size_t i = 0; i < row.size(); i++) out << (i ? "," : "") << csvField(row[i].second);
+    out << "\n";
+  }
+  else{
+    picojson::object obj;
+    for(const auto& [key, value] : row) obj[key] = value;
+    out << picojson::value(obj).serialize() << "\n";
+  }
+  out.flush();
+}
+
+void usage(){
+  std::cout << "Usage: ./06_benchmark [options]\n"
+            << "  --inputs a.txt,b.txt    prompt files, one matrix axis (input length)\n"
+            << "  --chunks 8,64           prefill chunk sizes (engine re-initialized per value)\n"
+            << "  --max-tokens 256,1024   max_tokens per request\n"
+            << "  --segments 1,5          tokens per Prefill(n) / Execute(n) segment\n"
+            << "  --n 10 --warmup 1       measured and warmup repetitions per configuration\n"
+            << "  --format jsonl|csv      output format (default jsonl)\n"
+            << "  --out results.jsonl     output file (default results.<format>)\n"
+            << "  --model-dir DIR --model-lib LIB --device cuda:0 --seed 4542" << std::endl;
+}
+
+// Segment types recorded per configuration, in output column order.
+const std::vector<std::string> kTypes = {
+  "request", "prefill segment", "prefill", "execute segment", "ttft", "inference", "total"
+};
+
+int main(int argc, char* argv[]){
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
+  std::string device = "cuda:0";
+  std::string mode = "local";
+  int seed = 4542;
+
+  std::vector<std::string> inputs = {"../02_cpp_segment_runner/input.txt"};
+  std::vector<int> chunk_sizes = {64};
+  std::vector<int> max_tokens_list = {256};
+  std::vector<int> segment_sizes = {1};
+  int n = 10;
+  int warmup = 1;
+  std::string format = "jsonl";
+  std::string out_path = "";
+
+  for(int i = 1; i < argc; i++){
+    std::string arg = argv[i];
+    if(arg == "-h" || arg == "--help"){
+      usage();
+      return 0;
+    }
+    if(i + 1 >= argc){
+      std::cout << "[ERROR] Missing value for " << arg << std::endl;
+      usage();
+      return 1;
+    }
+    std::string value = argv[++i];
+    if(arg == "--inputs") inputs = split(value, ',');
+    else if(arg == "--chunks") chunk_sizes = splitInt(value);
+    else if(arg == "--max-tokens") max_tokens_list = splitInt(value);
+    else if(arg == "--segments") segment_sizes = splitInt(value);
+    else if(arg == "--n") n = atoi(value.c_str());
+    else if(arg == "--warmup") warmup = atoi(value.c_str());
+    else if(arg == "--format") format = value;
+    else if(arg == "--out") out_path = value;
+    else if(arg == "--device") device = value;
+    else if(arg == "--seed") seed = atoi(value.c_str());
+    else{
+      std::cout << "[ERROR] Unknown option " << arg << std::endl;
+      usage();
+      return 1;
+    }
+  }
+
+  if(out_path.empty()) out_path = "results." + format;
+
+  tvm::Device dev;
+  if(!parseDevice(device, dev)){
+    std::cout << "[ERROR] Unknown device " << device << std::endl;
+    return 1;
+  }
+  if(format != "jsonl" && format != "csv"){
+    std::cout << "[ERROR] Unknown format " << format << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> prompts;
+  for(const std::string& input : inputs) prompts.push_back(readFileToString(input));
+
+  std::ofstream out(out_path);
+  if(!out.is_open()){
+    std::cout << "[ERROR] Cannot open " << out_path << std::endl;
+    return 1;
+  }
+
+  size_t num_configs = chunk_sizes.size() * prompts.size() * max_tokens_list.size() * segment_sizes.size();
+  size_t config_index = 0;
+  std::string started_at = timestamp();
+  std::string host = hostname();
+
+  // The chunk size is fixed at Init, so it is the outermost axis.
+  for(int prefill_chunk_size : chunk_sizes){
+    auto segment_runner = std::make_unique<SegmentRunner>();
+    segment_runner->Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
+
+    for(size_t input_index = 0; input_index < prompts.size(); input_index++){
+      for(int max_tokens : max_tokens_list){
+        for(int segment_size : segment_sizes){
+          config_index++;
+          std::cout << "[" << config_index << "/" << num_configs << "] input=" << inputs[input_index]
+                    << " chunk=" << prefill_chunk_size << " max_tokens=" << max_tokens
+                    << " segment=" << segment_size << std::endl;
+
+          segment_runner->SetSeed(seed); // Same sampling for every configuration
+          LatencyRecorder latency(warmup);
+          size_t output_chars = 0;
+          int execute_segments = 0;
+
+          for(int i = 0; i < n + warmup; i++){
+            latency.StartIteration(i);
+            auto total_start = std::chrono::high_resolution_clock::now();
+
+            // - Request
+            segment_runner->Request(prompts[input_index], max_tokens);
+            auto request_end = std::chrono::high_resolution_clock::now();
+            latency.Record("request", request_end - total_start);
+
+            // - Prefill
+            while(!segment_runner->IsPrefillEnd()){
+              auto s = std::chrono::high_resolution_clock::now();
+              segment_runner->Prefill(segment_size);
+              auto e = std::chrono::high_resolution_clock::now();
+              latency.Record("prefill segment", e - s);
+            }
+            auto prefill_end = std::chrono::high_resolution_clock::now();
+            latency.Record("prefill", prefill_end - request_end);
+            // The engine samples the first token with the last prefill chunk, so TTFT
+            // ends here and does not depend on the Execute segment size
+            latency.Record("ttft", prefill_end - total_start);
+
+            // - Inference
+            std::string output;
+            while(!segment_runner->IsEnd()){
+              auto s = std::chrono::high_resolution_clock::now();
+              std::string delta = segment_runner->Execute(segment_size);
+              auto e = std::chrono::high_resolution_clock::now();
+              latency.Record("execute segment", e - s);
+              if(!latency.warming_up()) execute_segments++;
+              output += delta;
+            }
+            auto total_end = std::chrono::high_resolution_clock::now();
+            latency.Record("inference", total_end - prefill_end);
+            latency.Record("total", total_end - total_start);
+            if(!latency.warming_up()) output_chars += output.size();
+          }
+
+          Row row;
+          row.emplace_back("git_commit", picojson::value(std::string(BENCH_GIT_COMMIT)));
+          row.emplace_back("started_at", picojson::value(started_at));
+          row.emplace_back("host", picojson::value(host));
+          row.emplace_back("model_dir", picojson::value(model_dir));
+          row.emplace_back("model_lib", picojson::value(model_lib_path));
+          row.emplace_back("device", picojson::value(device));
+          row.emplace_back("mode", picojson::value(mode));
+          row.emplace_back("seed", picojson::value(static_cast<double>(seed)));
+          row.emplace_back("input", picojson::value(inputs[input_index]));
+          row.emplace_back("input_chars", picojson::value(static_cast<double>(prompts[input_index].size())));
+          row.emplace_back("prefill_chunk_size", picojson::value(static_cast<double>(prefill_chunk_size)));
+          row.emplace_back("max_tokens", picojson::value(static_cast<double>(max_tokens)));
+          row.emplace_back("segment_size", picojson::value(static_cast<double>(segment_size)));
+          row.emplace_back("n", picojson::value(static_cast<double>(n)));
+          row.emplace_back("warmup", picojson::value(static_cast<double>(warmup)));
+          row.emplace_back("execute_segments", picojson::value(static_cast<double>(execute_segments)));
+          row.emplace_back("output_chars", picojson::value(static_cast<double>(output_chars)));
+          for(const std::string& type : kTypes) addStats(row, type, latency.Get(type));
+
+          writeRow(out, row, format, config_index == 1);
+        }
+      }
+    }
+  }
+
+  std::cout << "[INFO] " << num_configs << " configurations written to " << out_path << std::endl;
+
+  return 0;
+}
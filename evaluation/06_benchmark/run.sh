@@ -0,0 +1,12 @@
+#!/bin/bash
+
+# Full sweep: input length x prefill chunk size x max_tokens x segment size
+INPUT_DIR=../02_cpp_segment_runner
+
+./06_benchmark \
+    --inputs $INPUT_DIR/input_token_31.txt,$INPUT_DIR/input_token_164.txt,$INPUT_DIR/input_token_584.txt,$INPUT_DIR/input_token_1144.txt \
+    --chunks 8,64,256 \
+    --max-tokens 256,1024 \
+    --segments 1,5 \
+    --n 10 --warmup 1 \
+    --format jsonl --out results.jsonl
@@ -0,0 +1,207 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+
+#include <picojson.h>
+
+#include <serve/segment_runner/segment_runner.h>
+
+#include "load_generator.h"
+#include "model_paths.h"
+
+using namespace tvm;
+using namespace ffi;
+
+std::string readFileToString(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("파일을 열 수 없습니다: " + filePath);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();  // 전체 파일 내용을 스트림으로 읽기
+    return buffer.str();     // 문자열로 반환
+}
+
+std::vector<double> splitDouble(const std::string& s){
+  std::vector<double> values;
+  std::stringstream ss(s);
+  std::string item;
+  while(std::getline(ss, item, ',')){
+    if(!item.empty()) values.push_back(atof(item.c_str()));
+  }
+  return values;
+}
+
+// One request per line: {"prompt": "...", "max_tokens": 256, "timestamp": 0.25}
+// ("max_tokens" and "timestamp" in seconds are optional).
+std::vector<LoadRequest> readTrace(const std::string& path, int default_max_tokens){
+  std::ifstream file(path);
+  if(!file.is_open()){
+    std::cout << "[ERROR] Cannot open trace " << path << std::endl;
+    exit(0);
+  }
+  std::vector<LoadRequest> requests;
+  std::string line;
+  while(std::getline(file, line)){
+    if(line.empty()) continue;
+    picojson::value v;
+    std::string err = picojson::parse(v, line);
+    if(!err.empty() || !v.is<picojson::object>()){
+      std::cout << "[ERROR] Invalid trace line: " << line << std::endl;
+      exit(0);
+    }
+    const picojson::object& obj = v.get<picojson::object>();
+    LoadRequest request;
+    request.max_tokens = default_max_tokens;
+    if(obj.count("prompt") && obj.at("prompt").is<std::string>()) request.prompt = obj.at("prompt").get<std::string>();
+    if(obj.count("max_tokens") && obj.at("max_tokens").is<double>()) request.max_tokens = static_cast<int>(obj.at("max_tokens").get<double>());
+    if(obj.count("timestamp") && obj.at("timestamp").is<double>()) request.arrival_s = obj.at("timestamp").get<double>();
+    requests.push_back(request);
+  }
+  return requests;
+}
+
+void usage(){
+  std::cout << "Usage: ./07_load_generator [options]\n"
+            << "  --trace requests.jsonl  request trace (default: ../02_cpp_segment_runner/input.txt as every prompt)\n"
+            << "  --qps 0.5,1,2,4         Poisson arrival rates to sweep (default: trace timestamps)\n"
+            << "  --speedup 1             time compression of a trace-timed replay\n"
+            << "  --num-requests 100      requests per rate (the trace is cycled)\n"
+            << "  --max-tokens 256        when the trace does not set it\n"
+            << "  --workers 1             SegmentRunner engines serving in parallel (each unbatched)\n"
+            << "  --slo-ttft 1000 --slo-tpot 100  SLOs in ms for goodput\n"
+            << "  --chunk 64 --seed 4542\n"
+            << "  --model-dir DIR --model-lib LIB  (or MLC_MODEL_DIR / MLC_MODEL_LIB)" << std::endl;
+}
+
+int main(int argc, char* argv[]){
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
+  tvm::Device dev{kDLCUDA, 0};
+  std::string mode = "local";
+
+  std::string trace_path = "";
+  std::vector<double> qps_list;
+  double speedup = 1.0;
+  int num_requests = 100;
+  int max_tokens = 256;
+  int num_workers = 1;
+  int prefill_chunk_size = 64;
+  int seed = 4542;
+  LoadSlo slo;
+
+  for(int i = 1; i < argc; i++){
+    std::string arg = argv[i];
+    if(arg == "-h" || arg == "--help"){
+      usage();
+      return 0;
+    }
+    if(i + 1 >= argc){
+      std::cout << "[ERROR] Missing value for " << arg << std::endl;
+      usage();
+      exit(0);
+    }
+    std::string value = argv[++i];
+    if(arg == "--trace") trace_path = value;
+    else if(arg == "--qps") qps_list = splitDouble(value);
+    else if(arg == "--speedup") speedup = atof(value.c_str());
+    else if(arg == "--num-requests") num_requests = atoi(value.c_str());
+    else if(arg == "--max-tokens") max_tokens = atoi(value.c_str());
+    else if(arg == "--workers") num_workers = atoi(value.c_str());
+    else if(arg == "--slo-ttft") slo.ttft_ms = atof(value.c_str());
+    else if(arg == "--slo-tpot") slo.tpot_ms = atof(value.c_str());
+    else if(arg == "--chunk") prefill_chunk_size = atoi(value.c_str());
+    else if(arg == "--seed") seed = atoi(value.c_str());
+    else{
+      std::cout << "[ERROR] Unknown option " << arg << std::endl;
+      usage();
+      exit(0);
+    }
+  }
+
+  std::vector<LoadRequest> trace;
+  if(!trace_path.empty()){
+    trace = readTrace(trace_path, max_tokens);
+  }
+  else{
+    LoadRequest request;
+    request.prompt = readFileToString("../02_cpp_segment_runner/input.txt");
+    request.max_tokens = max_tokens;
+    trace.push_back(request);
+  }
+  if(trace.empty()){
+    std::cout << "[ERROR] Empty trace" << std::endl;
+    exit(0);
+  }
+  bool trace_timed = qps_list.empty();
+  if(trace_timed && trace.front().arrival_s < 0){
+    std::cout << "[ERROR] The trace has no timestamps, pass --qps" << std::endl;
+    exit(0);
+  }
+
+  // One engine per worker: a SegmentRunner serves one request at a time and
+  // never batches, so the knee below is that of N independent engines, not of
+  // the batching serving path. ./01_cpp_interface_prototype load runs the same
+  // generator through CppInterface, but only as a sequential baseline.
+  std::vector<std::unique_ptr<SegmentRunner>> runners;
+  for(int w = 0; w < num_workers; w++){
+    runners.push_back(std::make_unique<SegmentRunner>());
+    runners.back()->Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
+    runners.back()->SetSeed(seed);
+  }
+
+  std::string backend = "segment-runner x" + std::to_string(num_workers) + " (one unbatched engine per worker)";
+  LoadGenerator generator([&runners](int worker, const LoadRequest& request, const LoadGenerator::TokenCallback& on_tokens){
+    SegmentRunner& runner = *runners[worker];
+    runner.Request(request.prompt, request.max_tokens);
+    while(!runner.IsPrefillEnd()) runner.Prefill(1);
+    while(!runner.IsEnd()){
+      runner.Execute(1);
+      on_tokens(1, LoadGenerator::Clock::now());
+    }
+  }, num_workers, backend);
+
+  // - Warmup: one request per worker
+  {
+    std::vector<LoadRequest> warmup(runners.size(), trace.front());
+    generator.Run(warmup, std::vector<double>(warmup.size(), 0.0), slo);
+  }
+
+  if(trace_timed){
+    LoadReport report = generator.Run(trace, TraceArrivals(trace, speedup), slo);
+    PrintLoadReport(std::cout, report);
+    return 0;
+  }
+
+  std::vector<LoadRequest> requests;
+  for(int i = 0; i < num_requests; i++) requests.push_back(trace[i % trace.size()]);
+
+  std::vector<LoadReport> sweep;
+  for(double qps : qps_list){
+    LoadReport report = generator.Run(requests, PoissonArrivals(requests.size(), qps, seed), slo);
+    report.offered_qps = qps;
+    PrintLoadReport(std::cout, report);
+    sweep.push_back(report);
+  }
+
+  std::cout << "===========================" << std::endl;
+  std::cout << "# backend: " << backend << std::endl;
+  std::cout << "# QPS sweep (TTFT SLO " << slo.ttft_ms << "ms, TPOT SLO " << slo.tpot_ms << "ms)" << std::endl;
+  std::cout << "qps, throughput, goodput, attainment, ttft_p99_ms, tpot_p99_ms" << std::endl;
+  for(const LoadReport& report : sweep){
+    std::cout << report.offered_qps << ", " << report.throughput_qps << ", " << report.goodput_qps << ", "
+              << report.slo_attainment() << ", " << report.ttft.Percentile(99.0) / 1e6 << ", "
+              << report.tpot.Percentile(99.0) / 1e6 << std::endl;
+  }
+  std::cout << "Saturation knee (90% SLO attainment): " << FindKnee(sweep, 0.9) << " qps" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,11 @@
+#!/bin/bash
+
+# Poisson QPS sweep with TTFT/TPOT SLOs; prints the saturation knee at the end
+./07_load_generator --qps 0.25,0.5,1,2,4 --num-requests 100 --max-tokens 256 --slo-ttft 1000 --slo-tpot 50 > output_sweep.txt
+
+# Replay of a timestamped trace
+# ./07_load_generator --trace requests.jsonl --speedup 1 > output_trace.txt
+
+# Sequential baseline through CppInterface: one request in flight, so the batching
+# engine never sees concurrent requests (no knee is reported)
+# (cd ../../cpp/01_cpp_interface_prototype && ./01_cpp_interface_prototype load 0.25,0.5,1,2,4 100 256 > output_sweep_cpp_interface.txt)
@@ -0,0 +1,200 @@
+import time
+import threading
+from collections import deque
+
+import numpy as np
+from mlc_llm import MLCEngine
+from mlc_llm.serve import data, engine_base
+from mlc_llm.serve import engine as serve_engine
+from mlc_llm.tokenizers import TextStreamer
+
+# Per-step interface overhead of the Python engine, with the same stages as
+# cpp/common/token_breakdown.h (compare with
+# ./01_cpp_interface_prototype breakdown). The engine internals are wrapped
+# before the engine is created, so the stream-back callback it registers is
+# the instrumented one.
+
+MODEL_DIR = "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b/workspace"
+MODEL_SO = MODEL_DIR + "/llama-3.2-1b-cuda.so"
+
+prompt = "Why USA is the one of the strongest country?"
+n = 10
+warmup = 2
+max_tokens = 256
+
+STAGES = ["engine step", "stream-back callback", "queue handoff", "unpack",
+          "detokenize", "response construction", "caller wakeup"]
+
+
+class TokenBreakdown:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.pending = deque()
+        self.samples = {stage: [] for stage in STAGES}
+        self.wall = []
+        self.num_tokens = 0
+        self.active = False
+
+    def begin(self):
+        with self.lock:
+            self.pending.clear()
+        self.prev_received = self.last = time.perf_counter_ns()
+        self.active = False
+
+    def callback_enter(self):
+        with self.lock:
+            self.pending.append([time.perf_counter_ns(), None])
+
+    def callback_exit(self):
+        with self.lock:
+            if self.pending:
+                self.pending[-1][1] = time.perf_counter_ns()
+
+    def dequeued(self):
+        now = time.perf_counter_ns()
+        with self.lock:
+            enter, exit_ = self.pending.popleft() if self.pending else (now, now)
+        enter = max(enter, self.prev_received)
+        exit_ = max(exit_ or enter, enter)
+        self.stages = dict.fromkeys(STAGES, 0)
+        self.stages["engine step"] = enter - self.prev_received
+        self.stages["stream-back callback"] = exit_ - enter
+        self.stages["queue handoff"] = now - exit_
+        self.tokens = 0
+        self.active = True
+        self.last = now
+
+    def mark(self, stage):
+        if not self.active:
+            return
+        now = time.perf_counter_ns()
+        self.stages[stage] += now - self.last
+        self.last = now
+
+    def received(self):
+        if not self.active:
+            return
+        self.mark("caller wakeup")
+        self.active = False
+        if self.tokens == 0:
+            return
+        for stage in STAGES:
+            self.samples[stage].append(self.stages[stage])
+        self.wall.append(self.last - self.prev_received)
+        self.num_tokens += self.tokens
+        self.prev_received = self.last
+
+    def clear(self):
+        self.samples = {stage: [] for stage in STAGES}
+        self.wall = []
+        self.num_tokens = 0
+
+    def print(self, title):
+        wall_mean = np.mean(self.wall) if self.wall else 0.0
+        print("===========================")
+        print(f"# {title} ({len(self.wall)} steps, {self.num_tokens} tokens)")
+        print(f"{'stage':<24}{'mean_us':>12}{'p50_us':>12}{'p99_us':>12}{'share':>10}")
+
+        def row(name, values):
+            values = np.array(values if values else [0]) / 1e3
+            share = values.mean() * 1e3 / wall_mean * 100.0 if wall_mean > 0 else 0.0
+            print(f"{name:<24}{values.mean():>12.3f}{np.percentile(values, 50):>12.3f}"
+                  f"{np.percentile(values, 99):>12.3f}{share:>9.3f}%")
+
+        for stage in STAGES:
+            row(stage, self.samples[stage])
+        row("wall", self.wall)
+
+
+breakdown = TokenBreakdown()
+
+
+def wrap(owner, name, before=None, after=None):
+    original = getattr(owner, name)
+
+    def wrapper(*args, **kwargs):
+        if before:
+            before()
+        result = original(*args, **kwargs)
+        if after:
+            after(result)
+        return result
+
+    setattr(owner, name, wrapper)
+
+
+# - stream-back callback (engine thread)
+wrap(engine_base.EngineState, "_sync_request_stream_callback",
+     before=breakdown.callback_enter, after=lambda _: breakdown.callback_exit())
+
+
+# - unpack: one RequestStreamOutput at a time
+def after_unpack(result):
+    _, stream_outputs = result
+    if stream_outputs and stream_outputs[0].delta_token_ids is not None:
+        breakdown.tokens += len(stream_outputs[0].delta_token_ids)
+    breakdown.mark("unpack")
+
+
+wrap(data.RequestStreamOutput, "unpack", after=after_unpack)
+
+# - detokenize
+wrap(TextStreamer, "put", after=lambda _: breakdown.mark("detokenize"))
+wrap(TextStreamer, "finish", after=lambda _: breakdown.mark("detokenize"))
+
+# - response construction (engine.py calls it through the module)
+wrap(engine_base, "process_chat_completion_stream_output",
+     after=lambda _: breakdown.mark("response construction"))
+
+
+# - caller wakeup: every chunk _handle_chat_completion yields to the caller
+original_handle_chat_completion = serve_engine.MLCEngine._handle_chat_completion
+
+
+def handle_chat_completion(self, *args, **kwargs):
+    breakdown.begin()
+    for response in original_handle_chat_completion(self, *args, **kwargs):
+        breakdown.received()
+        yield response
+
+
+serve_engine.MLCEngine._handle_chat_completion = handle_chat_completion
+
+
+class TimedQueue:
+    """Marks the dequeue of sync_output_queue."""
+
+    def __init__(self, queue):
+        self.queue = queue
+
+    def get(self, *args, **kwargs):
+        item = self.queue.get(*args, **kwargs)
+        breakdown.dequeued()
+        return item
+
+    def __getattr__(self, name):
+        return getattr(self.queue, name)
+
+
+engine = MLCEngine(
+    MODEL_DIR,
+    model_lib=MODEL_SO,
+    device="cuda",
+    mode="local"
+)
+engine.state.sync_output_queue = TimedQueue(engine.state.sync_output_queue)
+
+for i in range(n + warmup):
+    if i == warmup:
+        breakdown.clear()
+    engine.chat.completions.create(
+        model=MODEL_DIR,
+        messages=[{"role": "user", "content": prompt}],
+        max_tokens=max_tokens,
+        stream=False,
+        seed=4542  # For same experiment
+    )
+
+engine.terminate()
+
+breakdown.print("Python engine per-step breakdown")
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# Same prompt, max_tokens 256 and seed 4542 through both front-ends
+(cd ../../cpp/01_cpp_interface_prototype && ./01_cpp_interface_prototype breakdown) > output_cpp.txt
+python python_breakdown.py > output_python.txt
+
+paste -d '\n' <(grep -A 9 "^# " output_cpp.txt) <(grep -A 9 "^# " output_python.txt)
@@ -0,0 +1,258 @@
+
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+#include "fast_sampler.h"
+#include "latency_histogram.h"
+
+// A/B of host sampling time per step: the softmax + sort baseline
+// (sampling::SampleReference) against the fast paths in fast_sampler.h,
+// for greedy, plain multinomial and top-k/top-p sampling across vocabulary
+// sizes. Logits are synthetic (normal noise with a few peaked tokens and a
+// --masked fraction set to -inf, as a grammar or logit bias would); both
+// samplers see the same logits and uniforms. The check column counts steps
+// where the fast path disagrees: a different greedy token, a top-k/top-p
+// token outside the baseline's nucleus, or any masked token.
+//
+// Afterwards a chi-square test draws --draws tokens per sampler from one
+// small-vocabulary distribution, for multinomial and top-k/top-p, and
+// compares the counts with the baseline's probabilities.
+//
+// Last, edge cases: top_p = 0 must keep only the most likely token, and
+// logits with every token masked must return 0 on both samplers.
+std::vector<std::string> split(const std::string& s, char delim){
+  std::vector<std::string> items;
+  std::stringstream ss(s);
+  std::string item;
+  while(std::getline(ss, item, delim)){
+    if(!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+std::vector<int> splitInt(const std::string& s){
+  std::vector<int> values;
+  for(const std::string& item : split(s, ',')) values.push_back(atoi(item.c_str()));
+  return values;
+}
+
+void makeLogits(std::mt19937& rng, int vocab, float masked, std::vector<float>& logits){
+  std::normal_distribution<float> noise(0.0f, 2.0f);
+  logits.resize(vocab);
+  for(float& v : logits) v = noise(rng);
+  // A handful of likely next tokens, like a trained model
+  std::uniform_int_distribution<int> token(0, vocab - 1);
+  for(int i = 0; i < 8; i++) logits[token(rng)] += 12.0f - i;
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  for(float& v : logits) if(unit(rng) < masked) v = -INFINITY;
+}
+
+// Upper 0.1% point of chi-square with df degrees of freedom (Wilson-Hilferty)
+double chiSquareCritical(int df){
+  double z = 3.0902;
+  double a = 2.0 / (9.0 * df);
+  return df * std::pow(1.0 - a + z * std::sqrt(a), 3.0);
+}
+
+// Pearson chi-square of counts against the baseline's probabilities. Cells
+// expecting fewer than 5 draws are pooled into one. Draws of a token the
+// baseline gives no probability (masked, or outside the nucleus) are
+// counted apart: any one of them fails the test.
+struct ChiSquare { double statistic = 0.0; int df = 0; long outside = 0; };
+
+ChiSquare chiSquare(const std::vector<long>& counts, const std::vector<double>& probs, long draws){
+  ChiSquare result;
+  double pooled_expected = 0.0, pooled_observed = 0.0;
+  int cells = 0;
+  for(size_t i = 0; i < counts.size(); i++){
+    double expected = probs[i] * draws;
+    if(probs[i] <= 0.0){
+      result.outside += counts[i];
+    }else if(expected < 5.0){
+      pooled_expected += expected;
+      pooled_observed += counts[i];
+    }else{
+      result.statistic += (counts[i] - expected) * (counts[i] - expected) / expected;
+      cells++;
+    }
+  }
+  if(pooled_expected > 0.0){
+    result.statistic += (pooled_observed - pooled_expected) * (pooled_observed - pooled_expected) / pooled_expected;
+    cells++;
+  }
+  result.df = std::max(1, cells - 1);
+  return result;
+}
+
+int main(int argc, char* argv[]){
+  std::vector<int> vocabs = {32000, 128256, 151936};
+  int n = 200;
+  int warmup = 20;
+  float masked = 0.1f;
+  long draws = 200000;
+  sampling::Params params;
+  params.temperature = 0.7f;
+  params.top_k = 50;
+  params.top_p = 0.9f;
+
+  for(int i = 1; i < argc; i++){
+    std::string arg(argv[i]);
+    if(i + 1 >= argc){
+      std::cout << "[ERROR] Missing value for " << arg << std::endl;
+      exit(0);
+    }
+    std::string value(argv[++i]);
+    if(arg == "--vocab") vocabs = splitInt(value);
+    else if(arg == "--n") n = atoi(value.c_str());
+    else if(arg == "--warmup") warmup = atoi(value.c_str());
+    else if(arg == "--temperature") params.temperature = atof(value.c_str());
+    else if(arg == "--top-k") params.top_k = atoi(value.c_str());
+    else if(arg == "--top-p") params.top_p = atof(value.c_str());
+    else if(arg == "--masked") masked = atof(value.c_str());
+    else if(arg == "--draws") draws = atol(value.c_str());
+    else{
+      std::cout << "[ERROR] Unknown option: " << arg << std::endl;
+      exit(0);
+    }
+  }
+
+  sampling::Params greedy;
+  greedy.temperature = 0.0f;
+  sampling::Params multinomial;
+  multinomial.temperature = params.temperature;
+
+  struct Mode { std::string name; sampling::Params params; };
+  std::vector<Mode> modes = {{"greedy", greedy}, {"multinomial", multinomial}, {"top-k/top-p", params}};
+
+  std::cout << "# simd: " << sampling::SimdName() << ", temperature " << params.temperature << ", top_k "
+            << params.top_k << ", top_p " << params.top_p << ", masked " << masked << ", " << n << " steps"
+            << std::endl;
+  std::cout << std::left << std::setw(10) << "vocab" << std::setw(14) << "mode" << std::right << std::setw(12)
+            << "ref_us" << std::setw(12) << "ref_p99" << std::setw(12) << "fast_us" << std::setw(12) << "fast_p99"
+            << std::setw(10) << "speedup" << std::setw(10) << "check" << std::endl;
+
+  std::mt19937 rng(4542); // For same experiment
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::vector<float> logits;
+  std::vector<int> nucleus;
+  sampling::Sampler sampler;
+
+  for(int vocab : vocabs){
+    for(const Mode& mode : modes){
+      LatencyHistogram reference_ns, fast_ns;
+      int mismatches = 0;
+      for(int i = 0; i < n + warmup; i++){
+        makeLogits(rng, vocab, masked, logits);
+        float u = unit(rng);
+
+        auto s = std::chrono::steady_clock::now();
+        int reference = sampling::SampleReference(logits.data(), vocab, mode.params, u, &nucleus);
+        auto m = std::chrono::steady_clock::now();
+        int fast = sampler.Sample(logits.data(), vocab, mode.params, u);
+        auto e = std::chrono::steady_clock::now();
+        if(i < warmup) continue;
+
+        reference_ns.Record(m - s);
+        fast_ns.Record(e - m);
+        if(sampling::IsGreedy(mode.params)) mismatches += reference != fast;
+        else if(mode.params.top_k > 0 || mode.params.top_p < 1.0f)
+          mismatches += std::find(nucleus.begin(), nucleus.end(), fast) == nucleus.end();
+        else mismatches += fast < 0 || fast >= vocab;
+        if(fast >= 0 && fast < vocab && std::isinf(logits[fast])) mismatches++;
+      }
+      double reference_us = reference_ns.mean() / 1e3;
+      double fast_us = fast_ns.mean() / 1e3;
+      std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(10) << vocab << std::setw(14)
+                << mode.name << std::right << std::setw(12) << reference_us << std::setw(12)
+                << reference_ns.Percentile(99.0) / 1e3 << std::setw(12) << fast_us << std::setw(12)
+                << fast_ns.Percentile(99.0) / 1e3 << std::setw(9) << (fast_us > 0.0 ? reference_us / fast_us : 0.0)
+                << "x" << std::setw(10) << mismatches << std::endl;
+    }
+  }
+
+  // Distribution check: one fixed small-vocabulary distribution, flat enough
+  // that top-k/top-p keeps many tokens, with some tokens masked
+  const int chi_vocab = 64;
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  logits.resize(chi_vocab);
+  for(float& v : logits) v = noise(rng);
+  for(int i = 0; i < chi_vocab; i += 8) logits[i] = -INFINITY;
+  std::cout << "# chi-square: vocab " << chi_vocab << ", " << chi_vocab / 8 << " masked, " << draws
+            << " draws, critical value at p = 0.001" << std::endl;
+  std::cout << std::left << std::setw(14) << "mode" << std::setw(12) << "sampler" << std::right << std::setw(12)
+            << "chi2" << std::setw(6) << "df" << std::setw(12) << "critical" << std::setw(10) << "outside"
+            << std::setw(8) << "result" << std::endl;
+  for(const Mode& mode : modes){
+    if(sampling::IsGreedy(mode.params)) continue;
+    // Baseline probabilities: softmax over the baseline's nucleus
+    sampling::SampleReference(logits.data(), chi_vocab, mode.params, 0.0f, &nucleus);
+    float max = *std::max_element(logits.begin(), logits.end());
+    std::vector<double> probs(chi_vocab, 0.0);
+    double sum = 0.0;
+    for(int token : nucleus){
+      if(std::isinf(logits[token])) continue;
+      probs[token] = std::exp((logits[token] - max) / mode.params.temperature);
+      sum += probs[token];
+    }
+    for(double& p : probs) p /= sum;
+
+    for(int fast = 0; fast < 2; fast++){
+      std::vector<long> counts(chi_vocab, 0);
+      for(long i = 0; i < draws; i++){
+        float u = unit(rng);
+        int token = fast ? sampler.Sample(logits.data(), chi_vocab, mode.params, u)
+                         : sampling::SampleReference(logits.data(), chi_vocab, mode.params, u);
+        counts[token]++;
+      }
+      ChiSquare result = chiSquare(counts, probs, draws);
+      double critical = chiSquareCritical(result.df);
+      bool pass = result.outside == 0 && result.statistic <= critical;
+      std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(14) << mode.name << std::setw(12)
+                << (fast ? "fast" : "reference") << std::right << std::setw(12) << result.statistic << std::setw(6)
+                << result.df << std::setw(12) << critical << std::setw(10) << result.outside << std::setw(8)
+                << (pass ? "pass" : "FAIL") << std::endl;
+    }
+  }
+
+  // Edge cases, on logits from the first vocabulary size
+  struct EdgeCase { std::string name; float masked; sampling::Params params; };
+  sampling::Params top_p_zero = params;
+  top_p_zero.top_k = 0;
+  top_p_zero.top_p = 0.0f;
+  sampling::Params top_k_top_p_zero = params;
+  top_k_top_p_zero.top_p = 0.0f;
+  std::vector<EdgeCase> edge_cases = {
+    {"top_p=0", masked, top_p_zero},
+    {"top_k+top_p=0", masked, top_k_top_p_zero},
+    {"all masked, multinomial", 1.0f, multinomial},
+    {"all masked, top-k/top-p", 1.0f, params},
+    {"all masked, top_p=0", 1.0f, top_p_zero},
+  };
+  std::cout << "# edge cases: vocab " << vocabs.front() << ", " << n << " steps" << std::endl;
+  std::cout << std::left << std::setw(26) << "case" << std::right << std::setw(10) << "check" << std::setw(8)
+            << "result" << std::endl;
+  for(const EdgeCase& edge : edge_cases){
+    int mismatches = 0;
+    for(int i = 0; i < n; i++){
+      makeLogits(rng, vocabs.front(), edge.masked, logits);
+      float u = unit(rng);
+      int reference = sampling::SampleReference(logits.data(), vocabs.front(), edge.params, u);
+      int fast = sampler.Sample(logits.data(), vocabs.front(), edge.params, u);
+      // Both keep only the argmax, or return 0 when nothing can be drawn
+      int expected = sampling::Argmax(logits.data(), vocabs.front());
+      mismatches += reference != expected || fast != expected;
+    }
+    std::cout << std::left << std::setw(26) << edge.name << std::right << std::setw(10) << mismatches
+              << std::setw(8) << (mismatches == 0 ? "pass" : "FAIL") << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,7 @@
+# -march=native picks the AVX2 / AVX-512 paths of fast_sampler.h when the CPU
+# has them; build with SIMD_FLAGS= for the scalar fallback.
+SIMD_FLAGS=${SIMD_FLAGS--march=native}
+
+g++ -std=c++20 -O2 $SIMD_FLAGS \
+    -o 09_sampling 09_sampling.cpp \
+    -I../../cpp/common
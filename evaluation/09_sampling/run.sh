@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# Llama-2 / Llama-3 / Qwen2 vocabularies
+./09_sampling --vocab 32000,128256,151936 --n 200 --warmup 20 > output.txt
@@ -0,0 +1,3 @@
+g++ -std=c++20 -O2 \
+    -o fit_cost_model fit_cost_model.cpp \
+    -I../../cpp/common
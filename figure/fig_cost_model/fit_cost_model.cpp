@@ -0,0 +1,112 @@
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+
+#include "cost_model.h"
+
+struct PrefillProfile {
+  int chunk;
+  std::string path;
+};
+
+// Replay profiler samples in order: predict first, then observe, so the
+// reported error and bound coverage are those of the online model.
+template <typename Predict, typename Observe>
+void Replay(const std::vector<double>& samples_ms, Predict predict, Observe observe, double& abs_err, int& covered, int& count){
+  for(int i = 0; i < static_cast<int>(samples_ms.size()); i++){
+    double us = samples_ms[i] * 1000.0;
+    CostModel::Prediction p = predict(i);
+    if(count > 0){
+      abs_err += std::fabs(us - p.mean_us);
+      if(us <= p.bound_us) covered++;
+    }
+    observe(i, us);
+    count++;
+  }
+}
+
+// Usage: ./fit_cost_model --prefill <chunk> <file> ... --decode <file> ... --output cost_model.txt
+int main(int argc, char* argv[]){
+  std::vector<PrefillProfile> prefill_profiles;
+  std::vector<std::string> decode_profiles;
+  std::string output_path = "cost_model.txt";
+
+  std::string mode;
+  for(int i = 1; i < argc; i++){
+    std::string arg(argv[i]);
+    if(arg == "--prefill" && i + 2 < argc){
+      prefill_profiles.push_back({atoi(argv[i+1]), argv[i+2]});
+      i += 2;
+      mode.clear();
+    }
+    else if(arg == "--decode") mode = "decode";
+    else if(arg == "--output" && i + 1 < argc) output_path = argv[++i];
+    else if(mode == "decode") decode_profiles.push_back(arg);
+  }
+
+  // Offline fit without forgetting; the runtime model forgets when it keeps learning.
+  CostModel model(3.0, 1.0);
+
+  double prefill_err = 0.0, decode_err = 0.0;
+  int prefill_covered = 0, decode_covered = 0, prefill_count = 0, decode_count = 0;
+
+  for(auto& profile : prefill_profiles){
+    std::vector<double> samples = CostModel::ReadProfileValues(profile.path, "prefill");
+    if(!samples.empty()) samples.pop_back(); // partial last chunk
+    // Request prefills chunk 0, the profiled chunks start at pos = chunk
+    Replay(samples,
+      [&](int i){ return model.PredictPrefillUs((i + 1) * profile.chunk, profile.chunk); },
+      [&](int i, double us){ model.ObservePrefill((i + 1) * profile.chunk, profile.chunk, us); },
+      prefill_err, prefill_covered, prefill_count);
+  }
+
+  for(auto& path : decode_profiles){
+    std::vector<double> samples = CostModel::ReadProfileValues(path, "execute");
+    int input_length = 0;
+    {
+      std::ifstream in(path);
+      std::string line;
+      while(std::getline(in, line)){
+        size_t at = line.find("input token length:");
+        if(at != std::string::npos){ input_length = std::stoi(line.substr(at + 19)); break; }
+      }
+    }
+    Replay(samples,
+      [&](int i){ return model.PredictDecodeUs(input_length + i); },
+      [&](int i, double us){ model.ObserveDecode(input_length + i, us); },
+      decode_err, decode_covered, decode_count);
+  }
+
+  std::vector<double> pc = model.PrefillCoefficients();
+  std::vector<double> dc = model.DecodeCoefficients();
+
+  std::cout << "===========================" << std::endl;
+  std::cout << "# prefill: t = " << pc[0] << " + " << pc[1] << " * chunk + " << pc[2] << " * pos + " << pc[3] << " * chunk * pos (us)" << std::endl;
+  std::cout << "samples: " << prefill_count << std::endl;
+  if(prefill_count > 1){
+    std::cout << "online mean abs error: " << prefill_err / (prefill_count - 1) / 1000.0 << "ms" << std::endl;
+    std::cout << "bound coverage: " << 100.0 * prefill_covered / (prefill_count - 1) << "%" << std::endl;
+  }
+  std::cout << "===========================" << std::endl;
+  std::cout << "# decode: t = " << dc[0] << " + " << dc[1] << " * ctx_len (us)" << std::endl;
+  std::cout << "samples: " << decode_count << std::endl;
+  if(decode_count > 1){
+    std::cout << "online mean abs error: " << decode_err / (decode_count - 1) / 1000.0 << "ms" << std::endl;
+    std::cout << "bound coverage: " << 100.0 * decode_covered / (decode_count - 1) << "%" << std::endl;
+  }
+  std::cout << "===========================" << std::endl;
+  for(int ctx : {64, 1024, 4096}){
+    CostModel::Prediction p = model.PredictDecodeUs(ctx);
+    std::cout << "decode ctx=" << ctx << ": " << p.mean_us / 1000.0 << "ms (bound " << p.bound_us / 1000.0 << "ms)" << std::endl;
+  }
+  for(int chunk : {16, 64, 256}){
+    CostModel::Prediction p = model.PredictPrefillUs(2048, chunk);
+    std::cout << "prefill pos=2048 chunk=" << chunk << ": " << p.mean_us / 1000.0 << "ms (bound " << p.bound_us / 1000.0 << "ms)" << std::endl;
+  }
+
+  model.Save(output_path);
+  return 0;
+}
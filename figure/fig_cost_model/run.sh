@@ -0,0 +1,11 @@
+#!/bin/bash
+
+# Fit the prefill/decode cost model from the existing profiler outputs
+./fit_cost_model \
+    --prefill 16 ../fig_prefill_time/output_chunk_16.txt \
+    --prefill 32 ../fig_prefill_time/output_chunk_32.txt \
+    --prefill 64 ../fig_prefill_time/output_chunk_64.txt \
+    --prefill 128 ../fig_prefill_time/output_chunk_128.txt \
+    --prefill 256 ../fig_prefill_time/output_chunk_256.txt \
+    --decode ../fig_execute_time/output_chunk64_input*.txt \
+    --output cost_model.txt > output.txt
@@ -12,30 +12,15 @@
 
 #include <serve/segment_runner/segment_runner.h>
 
+#include "latency_histogram.h"
+#include "model_paths.h"
+
 using namespace tvm;
 using namespace ffi;
 
 using ChatCompletionRequest = mlc::llm::json_ffi::ChatCompletionRequest;
 using ChatCompletionResponse = mlc::llm::json_ffi::ChatCompletionResponse;
 
-float calculate_duration_avg(std::vector<std::chrono::duration<float>> list){
-    if (list.empty()) return 0.0f;
-
-    float sum = 0.0f;
-    for (const auto& dur : list) {
-        sum += dur.count();
-    }
-    return sum / list.size();
-}
-
-float calculate_duration_max(std::vector<std::chrono::duration<float>> list){
-    if (list.empty()) return 0.0f;
-
-    auto max_itr = std::max_element(list.begin(), list.end(),
-        [](const auto& a, const auto& b) { return a.count() < b.count(); });
-    return max_itr->count();
-}
-
 std::string readFileToString(const std::string& filePath) {
     std::ifstream file(filePath);
     if (!file.is_open()) {
@@ -48,8 +33,9 @@ std::string readFileToString(const std::string& filePath) {
 }
 
 int main(int argc, char* argv[]){
-  std::string model_dir = "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b";
-  std::string model_lib_path = model_dir + "/llama-3.2-1b-cuda.so";
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
   tvm::Device dev{kDLCUDA, 0};
   std::string mode = "local";
   std::string input_data = "";
@@ -74,18 +60,15 @@ int main(int argc, char* argv[]){
   // std::string prompt("Why USA is the one of the strongest country?");
   std::string prompt = readFileToString(input_data);
   
-  std::vector<std::chrono::duration<float>> total_time_list;
-  std::vector<std::chrono::duration<float>> request_time_list;
-  std::vector<std::chrono::duration<float>> prefill_time_list;
-  std::vector<std::chrono::duration<float>> inference_time_list;
-
   int n = 1;
   int warmup = 1;
   int max_tokens = 1024*10;
 
   if(max_tokens_value > 0) max_tokens = max_tokens_value;
+  LatencyRecorder latency(warmup);
 
   for(int i = 0; i < n + warmup; i++){
+    latency.StartIteration(i);
     // - Request
     segment_runner.Request(prompt, max_tokens);
 
@@ -104,9 +87,13 @@ int main(int argc, char* argv[]){
       auto e = std::chrono::high_resolution_clock::now();
       auto duration = std::chrono::duration<float, std::milli>(e - s);
       if(i>=warmup) std::cout << std::fixed << std::setprecision(3) <<"execute: "<<duration.count() <<"ms"<<std::endl;
+      latency.Record("execute segment", e - s);
       output += delta;
     }
   }
 
+  // Summary on stderr, the per-segment lines on stdout are parsed by plot.py
+  latency.Print(std::cerr);
+
   return 0;
 }
\ No newline at end of file
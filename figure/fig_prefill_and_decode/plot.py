@@ -54,7 +54,7 @@ for line in lines:
         continue
     if "prefill" in line:
         try:
-            value = int(line.split(":")[1].replace("ms", "").strip())
+            value = float(line.split(":")[1].replace("ms", "").strip())
             y.append(value)
             x.append(i * chunk)
             i = i + 1
@@ -25,7 +25,7 @@ for chunk in chunk_list:
             continue
         if "prefill" in line:
             try:
-                value = int(line.split(":")[1].replace("ms", "").strip())
+                value = float(line.split(":")[1].replace("ms", "").strip())
                 y.append(value)
                 x.append((i+1) * chunk)
             except ValueError: 
@@ -84,7 +84,7 @@ for chunk in chunk_list:
             continue
         if "prefill" in line:
             try:
-                value = int(line.split(":")[1].replace("ms", "").strip())
+                value = float(line.split(":")[1].replace("ms", "").strip())
                 x.append((i+1) * chunk)
                 if i == 0: accumulated_y.append(value)
                 else: accumulated_y.append(accumulated_y[-1]+value)
@@ -0,0 +1,138 @@
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+
+// #include <json_ffi/conv_template.h>
+#include <json_ffi/openai_api_protocol.h>
+
+#include <serve/segment_runner/segment_runner.h>
+
+#include "latency_histogram.h"
+#include "model_paths.h"
+
+using namespace tvm;
+using namespace ffi;
+
+using ChatCompletionRequest = mlc::llm::json_ffi::ChatCompletionRequest;
+using ChatCompletionResponse = mlc::llm::json_ffi::ChatCompletionResponse;
+
+std::string readFileToString(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("파일을 열 수 없습니다: " + filePath);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();  // 전체 파일 내용을 스트림으로 읽기
+    return buffer.str();     // 문자열로 반환
+}
+
+std::vector<int> splitInt(const std::string& s, char delimiter){
+  std::vector<int> values;
+  std::stringstream ss(s);
+  std::string item;
+  while(std::getline(ss, item, delimiter)){
+    if(!item.empty()) values.push_back(atoi(item.c_str()));
+  }
+  return values;
+}
+
+// Segment overhead measurement: Execute(n) segment time against n, fitted
+// with the least-squares line
+//   segment_ms = a + b * n
+// which splits a segment into a per-segment overhead `a` (action selection,
+// host sync, stream-back, detokenize) and a per-token cost `b`. The engine
+// runs one step per token, so the overhead is paid n times and `a` stays
+// near 0. This only measures that; there is no multi-step decode mode to
+// compare it with.
+int main(int argc, char* argv[]){
+  // ./profile_segment_overhead [max_tokens] [prefill_chunk_size] [input] [steps, e.g. 1,2,4,8,16,32]
+  ModelPaths model_paths = ModelPaths::FromArgs(argc, argv, "/home/rubis/workspace/llama/mlc-llm-models/llama-3.2-1b");
+  std::string model_dir = model_paths.model_dir;
+  std::string model_lib_path = model_paths.model_lib;
+  tvm::Device dev{kDLCUDA, 0};
+  std::string mode = "local";
+  std::string input_data = "input.txt";
+
+  int max_tokens = 512;
+  int prefill_chunk_size = 64;
+  std::vector<int> steps = {1, 2, 4, 8, 16, 32};
+  int warmup = 1;
+
+  if(argc > 1) max_tokens = atoi(argv[1]);
+  if(argc > 2) prefill_chunk_size = atoi(argv[2]);
+  if(argc > 3) input_data = std::string(argv[3]);
+  if(argc > 4) steps = splitInt(argv[4], ',');
+  if(steps.empty()){
+    std::cout << "[ERROR] No steps given" << std::endl;
+    exit(0);
+  }
+
+  SegmentRunner segment_runner;
+  segment_runner.Init(model_dir, dev, model_lib_path, mode, prefill_chunk_size);
+  segment_runner.SetSeed(4542); // For same experiment
+
+  std::string prompt = readFileToString(input_data);
+
+  // Full segments only: the last one may stop early at EOS / max_tokens
+  std::vector<LatencyHistogram> segment_ns(steps.size());
+  double sum_n = 0.0, sum_t = 0.0, sum_nn = 0.0, sum_nt = 0.0, sum_tt = 0.0;
+  uint64_t count = 0;
+
+  for(int w = 0; w < warmup; w++){
+    segment_runner.Request(prompt, max_tokens);
+    while(!segment_runner.IsPrefillEnd()) segment_runner.Prefill(1);
+    while(!segment_runner.IsEnd()) segment_runner.Execute(steps.back());
+  }
+
+  for(size_t s = 0; s < steps.size(); s++){
+    int n = steps[s];
+    segment_runner.Request(prompt, max_tokens);
+    while(!segment_runner.IsPrefillEnd()) segment_runner.Prefill(1);
+
+    while(!segment_runner.IsEnd()){
+      auto start = std::chrono::steady_clock::now();
+      segment_runner.Execute(n);
+      auto end = std::chrono::steady_clock::now();
+      if(segment_runner.IsEnd()) break;
+
+      double ms = std::chrono::duration<double, std::milli>(end - start).count();
+      std::cout << std::fixed << std::setprecision(3) << "segment: n=" << n << " " << ms << "ms" << std::endl;
+      segment_ns[s].Record(end - start);
+      sum_n += n; sum_t += ms; sum_nn += static_cast<double>(n) * n; sum_nt += n * ms; sum_tt += ms * ms;
+      count++;
+    }
+  }
+
+  std::cout << "===========================" << std::endl;
+  std::cout << std::left << std::setw(8) << "n" << std::right << std::setw(12) << "segments" << std::setw(14)
+            << "mean_ms" << std::setw(14) << "p99_ms" << std::setw(14) << "ms/token" << std::endl;
+  for(size_t s = 0; s < steps.size(); s++){
+    const LatencyHistogram& h = segment_ns[s];
+    std::cout << std::left << std::setw(8) << steps[s] << std::right << std::setw(12) << h.count()
+              << std::setw(14) << h.mean() / 1e6 << std::setw(14) << h.Percentile(99.0) / 1e6 << std::setw(14)
+              << h.mean() / 1e6 / steps[s] << std::endl;
+  }
+
+  double denom = count * sum_nn - sum_n * sum_n;
+  if(count < 2 || denom == 0.0){
+    std::cout << "[ERROR] Need segments for at least two different n to fit" << std::endl;
+    exit(0);
+  }
+  double b = (count * sum_nt - sum_n * sum_t) / denom;
+  double a = (sum_t - b * sum_n) / count;
+  double ss_tot = sum_tt - sum_t * sum_t / count;
+  double ss_res = sum_tt - a * sum_t - b * sum_nt;
+  std::cout << "fit: segment_ms = " << a << " + " << b << " * n (R^2 "
+            << (ss_tot > 0.0 ? 1.0 - ss_res / ss_tot : 1.0) << ")" << std::endl;
+  std::cout << "per-segment overhead: " << a << "ms (" << (a + b > 0.0 ? a / (a + b) * 100.0 : 0.0)
+            << "% of Execute(1))" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,5 @@
+#!/bin/bash
+
+MAX_TOKENS=512
+
+./profile_segment_overhead $MAX_TOKENS 64 ../fig_execute_time/input_length_399.txt 1,2,4,8,16,32 > output_input399.txt